@@ -0,0 +1,362 @@
+#ifndef _atomic_shared_ptr_vector_h_
+#define _atomic_shared_ptr_vector_h_
+
+/**
+ * atomic_shared_ptr_vector is a shared_ptr_vector of atomically replaced slots
+ * author : dhan71@naver.com
+ */
+/**
+*  @brief  A fixed number of slots, each of which may be loaded, stored,
+*  exchanged and compared-and-exchanged atomically from any thread.
+*
+*  @tparam _Tp  Type of element.
+*  @tparam _Policy  Ownership policy (see shared_ptr_policy).
+*
+*  A slot holds a pointer to a node which owns the shared_data_type.
+*  store() swaps the node in with one atomic exchange and retires the old
+*  one.  load() guards the node with a hazard pointer while it copies the
+*  shared_data_type out, so it takes no lock, unlike std::atomic_load on
+*  a shared_ptr, which locks one of a pool of mutexes.  Retired nodes are
+*  deleted once no hazard pointer guards them.
+*
+*  Every thread which loads owns one hazard pointer of
+*  shared_ptr_hazard_domain::instance(), taken the first time and given
+*  back when the thread exits.
+*
+*  @Note The number of slots is fixed.  local_ptr_policy must not be
+*        used, since its counts are not atomic.
+*/
+
+#include <shared_ptr_vector.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+*  @brief  The hazard pointers of all the threads, one per thread.
+*/
+class shared_ptr_hazard_domain
+{
+public:
+  struct alignas(64) record
+  {
+    std::atomic<const void*> hazard{nullptr};
+    std::atomic<bool>        active{true};
+    record*                  next = nullptr;
+  };
+
+  /**  Returns the domain of all the atomic_shared_ptr_vectors.  */
+  static shared_ptr_hazard_domain&
+  instance()
+  {
+    static shared_ptr_hazard_domain __d;
+    return __d;
+  }
+
+  /**  Returns the record of the calling thread.  */
+  static record*
+  local()
+  {
+    static thread_local _Owner __o(instance()._M_acquire());
+    return __o.iRecord;
+  }
+
+  /**
+   *  @brief  Collects the pointers guarded now.
+   *  @param  __out  Filled with the guarded pointers, sorted.
+   */
+  void
+  hazards(std::vector<const void*>& __out) const
+  {
+    __out.clear();
+    for (record* __r = iHead.load(std::memory_order_acquire); __r; __r = __r->next)
+      if (const void* __p = __r->hazard.load())
+        __out.push_back(__p);
+    std::sort(__out.begin(), __out.end());
+  }
+
+  ~shared_ptr_hazard_domain()
+  {
+    record* __r = iHead.load(std::memory_order_relaxed);
+    while (__r)
+    {
+      record* __next = __r->next;
+      delete __r;
+      __r = __next;
+    }
+  }
+
+private:
+  struct _Owner
+  {
+    explicit
+    _Owner(record* __r)
+    : iRecord(__r)
+    { }
+
+    ~_Owner()
+    {
+      iRecord->hazard.store(nullptr, std::memory_order_relaxed);
+      iRecord->active.store(false, std::memory_order_release);
+    }
+
+    record* iRecord;
+  };
+
+  shared_ptr_hazard_domain()
+  { }
+
+  // reuses the record of an exited thread, or adds one
+  record*
+  _M_acquire()
+  {
+    for (record* __r = iHead.load(std::memory_order_acquire); __r; __r = __r->next)
+    {
+      bool __f = false;
+      if (!__r->active.load(std::memory_order_relaxed)
+          && __r->active.compare_exchange_strong(__f, true, std::memory_order_acquire))
+        return __r;
+    }
+    record* __r = new record;
+    __r->next = iHead.load(std::memory_order_relaxed);
+    while (!iHead.compare_exchange_weak(__r->next, __r, std::memory_order_release, std::memory_order_relaxed))
+      ;
+    return __r;
+  }
+
+  std::atomic<record*> iHead{nullptr};
+};
+
+template<typename _Tp, typename _Policy = typename default_ptr_policy<_Tp>::type>
+class atomic_shared_ptr_vector
+{
+public:
+  typedef typename _Policy::pointer shared_data_type;
+
+  typedef _Tp                  value_type;
+  typedef _Tp*                 data_type;
+  typedef std::size_t          size_type;
+
+public:
+  /**
+   *  @brief  Creates an atomic_shared_ptr_vector with NULL slots.
+   *  @param  __n  The number of slots.
+   */
+  explicit
+  atomic_shared_ptr_vector(size_type __n)
+  : iSlots(__n)
+  { }
+
+  /**
+   *  @brief  Creates an atomic_shared_ptr_vector with the elements of a
+   *          shared_ptr_vector.
+   *  @param  __x  A shared_ptr_vector whose elements are shared.
+   */
+  template<typename _Alloc>
+  explicit
+  atomic_shared_ptr_vector(const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x)
+  : iSlots(__x.size())
+  {
+    size_type __i = 0;
+    for (auto __p = __x.begin(); __p != __x.end(); ++__p, ++__i)
+      if (*__p)
+        iSlots[__i].store(new _Node(*__p), std::memory_order_relaxed);
+  }
+
+  atomic_shared_ptr_vector(const atomic_shared_ptr_vector&) = delete;
+  atomic_shared_ptr_vector& operator=(const atomic_shared_ptr_vector&) = delete;
+
+  /**
+   *  No other thread may use the atomic_shared_ptr_vector meanwhile.
+   */
+  ~atomic_shared_ptr_vector()
+  {
+    for (auto __i = iSlots.begin(); __i != iSlots.end(); ++__i)
+      delete __i->load(std::memory_order_relaxed);
+    for (auto __i = iRetired.begin(); __i != iRetired.end(); ++__i)
+      delete *__i;
+  }
+
+public:
+  size_type
+  size() const
+  { return iSlots.size(); }
+
+  /**
+   *  @brief  Copies the element of a slot, without locks.
+   *  @param  __n  The index of the slot, less than size().
+   *  @return  The element, or NULL.
+   */
+  shared_data_type
+  load(size_type __n) const
+  {
+    shared_ptr_hazard_domain::record* __r = shared_ptr_hazard_domain::local();
+    _Node* __p = _S_protect(iSlots[__n], __r);
+    shared_data_type __x(__p ? __p->iData : shared_data_type());
+    __r->hazard.store(nullptr, std::memory_order_release);
+    return __x;
+  }
+
+  /**
+   *  @brief  Replaces the element of a slot.
+   *  @param  __n  The index of the slot, less than size().
+   *  @param  __x  The new element, or NULL.
+   */
+  void
+  store(size_type __n, shared_data_type __x)
+  { _M_retire(iSlots[__n].exchange(_S_node(std::move(__x)))); }
+
+  /**
+   *  @brief  Replaces the element of a slot with a new pointer.
+   *  @param  __n  The index of the slot, less than size().
+   *  @param  __x  Data to be stored, owned afterwards.
+   */
+  void
+  store(size_type __n, const data_type& __x)
+  { store(__n, shared_data_type(__x)); }
+
+  void
+  store(size_type __n, std::nullptr_t)
+  { store(__n, shared_data_type()); }
+
+  /**
+   *  @brief  Replaces the element of a slot.
+   *  @param  __n  The index of the slot, less than size().
+   *  @param  __x  The new element, or NULL.
+   *  @return  The element replaced.
+   */
+  shared_data_type
+  exchange(size_type __n, shared_data_type __x)
+  {
+    _Node* __old = iSlots[__n].exchange(_S_node(std::move(__x)));
+    // readers may still copy out of __old, which is not deleted before
+    // it is retired
+    shared_data_type __r(__old ? __old->iData : shared_data_type());
+    _M_retire(__old);
+    return __r;
+  }
+
+  /**
+   *  @brief  Replaces the element of a slot if it is the expected one.
+   *  @param  __n  The index of the slot, less than size().
+   *  @param  __expected  The expected element; the element found if it
+   *                      is not.
+   *  @param  __desired  The new element.
+   *  @return  true if the element was replaced.
+   *
+   *  Elements are compared by their pointers.
+   */
+  bool
+  compare_exchange(size_type __n, shared_data_type& __expected, shared_data_type __desired)
+  {
+    shared_ptr_hazard_domain::record* __r = shared_ptr_hazard_domain::local();
+    _Node* __new = _S_node(std::move(__desired));
+    for (;;)
+    {
+      _Node* __p = _S_protect(iSlots[__n], __r);
+      if ((__p ? __p->iData.get() : nullptr) != __expected.get())
+      {
+        __expected = __p ? __p->iData : shared_data_type();
+        __r->hazard.store(nullptr, std::memory_order_release);
+        delete __new;
+        return false;
+      }
+      const bool __done = iSlots[__n].compare_exchange_strong(__p, __new);
+      __r->hazard.store(nullptr, std::memory_order_release);
+      if (__done)
+      {
+        _M_retire(__p);
+        return true;
+      }
+    }
+  }
+
+  /**
+   *  @brief  Deletes the retired nodes which no thread guards.
+   *  @return  Number of nodes left retired.
+   *
+   *  store(), exchange() and compare_exchange() call this every
+   *  _S_reclaim_batch retirements.
+   */
+  size_type
+  reclaim()
+  {
+    std::lock_guard<std::mutex> __l(iRetiredLock);
+    return _M_reclaim();
+  }
+
+  /**  Returns the number of replaced nodes not yet deleted.  */
+  size_type
+  retired() const
+  {
+    std::lock_guard<std::mutex> __l(iRetiredLock);
+    return iRetired.size();
+  }
+
+private:
+  struct _Node
+  {
+    explicit
+    _Node(shared_data_type __x)
+    : iData(std::move(__x))
+    { }
+
+    shared_data_type iData;
+  };
+
+  static constexpr size_type _S_reclaim_batch = 64;
+
+  static _Node*
+  _S_node(shared_data_type&& __x)
+  { return __x ? new _Node(std::move(__x)) : nullptr; }
+
+  // sets the hazard pointer of __r to the node of __s
+  static _Node*
+  _S_protect(const std::atomic<_Node*>& __s, shared_ptr_hazard_domain::record* __r)
+  {
+    _Node* __p = __s.load(std::memory_order_acquire);
+    for (;;)
+    {
+      // seq_cst with the exchange of the writers: either they see the
+      // hazard, or this thread sees their new node
+      __r->hazard.store(__p);
+      _Node* __q = __s.load();
+      if (__q == __p)
+        return __p;
+      __p = __q;
+    }
+  }
+
+  void
+  _M_retire(_Node* __p)
+  {
+    if (!__p)
+      return;
+    std::lock_guard<std::mutex> __l(iRetiredLock);
+    iRetired.push_back(__p);
+    if (iRetired.size() >= _S_reclaim_batch)
+      _M_reclaim();
+  }
+
+  size_type
+  _M_reclaim()
+  {
+    std::vector<const void*> __h;
+    shared_ptr_hazard_domain::instance().hazards(__h);
+    auto __keep = std::partition(iRetired.begin(), iRetired.end(),
+                                 [&__h](_Node* __p) { return std::binary_search(__h.begin(), __h.end(), __p); });
+    for (auto __i = __keep; __i != iRetired.end(); ++__i)
+      delete *__i;
+    iRetired.erase(__keep, iRetired.end());
+    return iRetired.size();
+  }
+
+  std::vector<std::atomic<_Node*> > iSlots;
+  std::vector<_Node*>               iRetired;
+  mutable std::mutex                iRetiredLock;
+};
+
+#endif /* _atomic_shared_ptr_vector_h_ */
@@ -0,0 +1,73 @@
+/**
+ * bench_atomic compares atomic_shared_ptr_vector::load with std::atomic_load
+ * on a shared_ptr, which locks one of a pool of mutexes, while a writer
+ * replaces the element.
+ *
+ * usage : bench_atomic [loads per thread] [reader threads]   (default 10000000, hardware threads)
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <atomic_shared_ptr_vector.h>
+using namespace std;
+
+template<typename _Load, typename _Store>
+double
+run(size_t n, unsigned threads, _Load load, _Store store)
+{
+  typedef chrono::steady_clock clock;
+
+  atomic<bool> done(false);
+  thread writer([&done, &store]
+                {
+                  for (int i = 0; !done.load(memory_order_relaxed); ++i)
+                  {
+                    store(i);
+                    this_thread::yield();
+                  }
+                });
+  vector<thread> t;
+  auto t0 = clock::now();
+  for (unsigned k = 0; k < threads; ++k)
+    t.emplace_back([&load, n]
+                   {
+                     long sum = 0;
+                     for (size_t i = 0; i < n; ++i)
+                       sum += *load();
+                     if (sum == -1)
+                       cout << sum;
+                   });
+  for (auto& i : t)
+    i.join();
+  double ms = chrono::duration<double, milli>(clock::now() - t0).count();
+  done.store(true);
+  writer.join();
+  return ms;
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t n = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 10000000;
+  unsigned threads = (argc > 2) ? strtoul(argv[2], nullptr, 10) : thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+  cout << "loads per thread : " << n << ", reader threads : " << threads << endl;
+
+  {
+    atomic_shared_ptr_vector<int> v(1);
+    v.store(0, make_shared<int>(0));
+    double ms = run(n, threads, [&v] { return v.load(0); }, [&v](int i) { v.store(0, make_shared<int>(i)); });
+    cout << "atomic_shared_ptr_vector::load : " << ms << " ms (" << n * threads / ms / 1000 << " M loads/s)" << endl;
+  }
+  {
+    shared_ptr<int> p = make_shared<int>(0);
+    double ms = run(n, threads, [&p] { return atomic_load(&p); }, [&p](int i) { atomic_store(&p, make_shared<int>(i)); });
+    cout << "std::atomic_load               : " << ms << " ms (" << n * threads / ms / 1000 << " M loads/s)" << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,61 @@
+/**
+ * bench_concurrent compares concurrent_shared_ptr_vector with a std::vector
+ * of shared_ptrs behind a mutex on appends from many threads.
+ *
+ * usage : bench_concurrent [elements] [threads]   (default 10000000, hardware threads)
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <concurrent_shared_ptr_vector.h>
+using namespace std;
+
+template<typename _Append>
+double
+run(size_t n, unsigned threads, _Append append)
+{
+  typedef chrono::steady_clock clock;
+
+  vector<thread> t;
+  auto t0 = clock::now();
+  for (unsigned k = 0; k < threads; ++k)
+    t.emplace_back([&append, n, threads, k]
+                   {
+                     for (size_t i = k; i < n; i += threads)
+                       append(int(i));
+                   });
+  for (auto& i : t)
+    i.join();
+  return chrono::duration<double, milli>(clock::now() - t0).count();
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t n = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 10000000;
+  unsigned threads = (argc > 2) ? strtoul(argv[2], nullptr, 10) : thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+  cout << "elements : " << n << ", threads : " << threads << endl;
+
+  {
+    concurrent_shared_ptr_vector<int> v;
+    double ms = run(n, threads, [&v](int i) { v.emplace_back(i); });
+    cout << "concurrent_shared_ptr_vector : " << ms << " ms (" << n / ms / 1000 << " M appends/s)" << endl;
+  }
+  {
+    mutex m;
+    vector<shared_ptr<int> > v;
+    double ms = run(n, threads, [&m, &v](int i)
+                    {
+                      shared_ptr<int> p = make_shared<int>(i);
+                      lock_guard<mutex> g(m);
+                      v.push_back(move(p));
+                    });
+    cout << "mutex + std::vector          : " << ms << " ms (" << n / ms / 1000 << " M appends/s)" << endl;
+  }
+  return 0;
+}
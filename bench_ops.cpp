@@ -0,0 +1,222 @@
+/**
+ * bench_ops measures the operations of shared_ptr_vector over sizes from
+ * 1e2 to [max elements] and elements of 4, 64 and 256 bytes.
+ *
+ * Each operation is repeated until it has run for [min ms]; it reports
+ * ns/op, allocations/op (counted by a replaced operator new) and Mops/s,
+ * where an op is one element touched (one insert or erase for those).
+ * Sizes whose elements would take more than 4 GiB are skipped.
+ *
+ * usage : bench_ops [max elements] [min ms] [json file]   (default 1000000, 100, none)
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include <shared_ptr_vector.h>
+using namespace std;
+
+static atomic<size_t> allocations(0);
+
+__attribute__((noinline)) void*
+operator new(size_t n)
+{
+  allocations.fetch_add(1, memory_order_relaxed);
+  if (void* p = malloc(n ? n : 1))
+    return p;
+  throw bad_alloc();
+}
+
+__attribute__((noinline)) void
+operator delete(void* p) noexcept
+{ free(p); }
+
+__attribute__((noinline)) void
+operator delete(void* p, size_t) noexcept
+{ free(p); }
+
+/// An element of _Size bytes, ordered by its key.
+template<size_t _Size>
+struct blob
+{
+  blob(long k = 0) : key(k) { }
+
+  long key;
+  char pad[_Size - sizeof(long)];
+
+  bool operator==(const blob& x) const { return key == x.key; }
+  bool operator<(const blob& x) const { return key < x.key; }
+};
+
+template<size_t _Size>
+ostream&
+operator<<(ostream& os, const blob<_Size>& x)
+{ return os << x.key; }
+
+static long
+key_of(int x)
+{ return x; }
+
+template<size_t _Size>
+static long
+key_of(const blob<_Size>& x)
+{ return x.key; }
+
+struct result
+{
+  string op;
+  string type;
+  size_t n;
+  double ns_per_op;
+  double allocs_per_op;
+  double mops;
+};
+
+static vector<result> results;
+static double min_ms = 100;
+
+/**
+ *  Runs __setup then __op until __op has taken min_ms in total, and
+ *  records the time and allocations of __op per __ops ops.
+ */
+template<typename _Setup, typename _Op>
+void
+measure(const string& op, const string& type, size_t n, size_t ops, _Setup setup, _Op run)
+{
+  typedef chrono::steady_clock clock;
+
+  double ns = 0;
+  size_t allocs = 0;
+  size_t reps = 0;
+  do
+  {
+    setup();
+    size_t a0 = allocations.load(memory_order_relaxed);
+    auto t0 = clock::now();
+    run();
+    auto t1 = clock::now();
+    allocs += allocations.load(memory_order_relaxed) - a0;
+    ns += chrono::duration<double, nano>(t1 - t0).count();
+    ++reps;
+  } while (ns < min_ms * 1e6);
+
+  result r;
+  r.op = op;
+  r.type = type;
+  r.n = n;
+  r.ns_per_op = ns / (double(reps) * ops);
+  r.allocs_per_op = double(allocs) / (double(reps) * ops);
+  r.mops = 1e3 / r.ns_per_op;
+  results.push_back(r);
+  printf("%-14s %-9s %10zu %10.2f ns/op %8.3f allocs/op %9.2f Mops/s\n",
+         op.c_str(), type.c_str(), n, r.ns_per_op, r.allocs_per_op, r.mops);
+  fflush(stdout);
+}
+
+template<typename _Tp>
+void
+run_type(const string& type, size_t max_n)
+{
+  typedef shared_ptr_vector<_Tp> vec;
+
+  for (size_t n = 100; n <= max_n; n *= 10)
+  {
+    if (n * (sizeof(_Tp) + 32) > (size_t(1) << 32))
+    {
+      printf("%-14s %-9s %10zu skipped\n", "*", type.c_str(), n);
+      continue;
+    }
+
+    // keys in a shuffled order, and a vector holding them
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i)
+      keys[i] = int(i);
+    shuffle(keys.begin(), keys.end(), mt19937(1));
+    vec src;
+    src.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+      src.emplace_back(keys[i]);
+    // inserts and erases in the middle, fewer as each one moves more
+    const size_t k = max(size_t(10), min(min(n, size_t(1000)), size_t(10000000) / n));
+
+    vec v;
+    measure("push_back", type, n, n, [&] { v = vec(); },
+            [&] { for (size_t i = 0; i < n; ++i) v.push_back(_Tp(keys[i])); });
+    measure("emplace_back", type, n, n, [&] { v = vec(); },
+            [&] { for (size_t i = 0; i < n; ++i) v.emplace_back(keys[i]); });
+    measure("copy", type, n, n, [&] { v = vec(); },
+            [&] { vec c(src); v.swap(c); });
+    measure("assign", type, n, n, [&] { v = vec(); },
+            [&] { v = src; });
+    measure("resize", type, n, n, [&] { v = vec(); },
+            [&] { v.resize(n); });
+    measure("insert", type, n, k, [&] { v = src; },
+            [&] { for (size_t i = 0; i < k; ++i) v.insert(v.begin() + v.size() / 2, new _Tp(keys[i])); });
+    measure("erase", type, n, k, [&] { v = src; },
+            [&] { for (size_t i = 0; i < k; ++i) v.erase(v.begin() + v.size() / 2); });
+    measure("sort", type, n, n, [&] { v = src; },
+            [&] { v.sort(); });
+
+    const _Tp missing(-1);
+    volatile bool found = false;
+    measure("find", type, n, n, [] { },
+            [&] { found = src.find(static_cast<_Tp*>(nullptr)) != src.end(); });
+    measure("find_value", type, n, n, [] { },
+            [&] { found = src.find_value(missing) != src.end(); });
+    measure("find_if_value", type, n, n, [] { },
+            [&] { found = src.find_if_value([](const _Tp& x) { return key_of(x) < 0; }) != src.end(); });
+
+    vec other(src);
+    measure("operator==", type, n, n, [] { },
+            [&] { found = (src == other); });
+    measure("operator<", type, n, n, [] { },
+            [&] { found = (src < other); });
+    volatile size_t length = 0;
+    measure("to_string", type, n, n, [] { },
+            [&] { length = to_string(src).size(); });
+    (void)found;
+    (void)length;
+  }
+}
+
+static void
+write_json(const char* path)
+{
+  ofstream os(path);
+  os << "{\n  \"benchmark\": \"bench_ops\",\n  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const result& r = results[i];
+    char line[256];
+    snprintf(line, sizeof(line),
+             "    {\"op\": \"%s\", \"type\": \"%s\", \"n\": %zu, \"ns_per_op\": %.3f, \"allocs_per_op\": %.4f, \"mops\": %.3f}%s\n",
+             r.op.c_str(), r.type.c_str(), r.n, r.ns_per_op, r.allocs_per_op, r.mops,
+             i + 1 < results.size() ? "," : "");
+    os << line;
+  }
+  os << "  ]\n}\n";
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t max_n = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 1000000;
+  if (argc > 2)
+    min_ms = strtod(argv[2], nullptr);
+
+  run_type<int>("int", max_n);
+  run_type<blob<64> >("blob64", max_n);
+  run_type<blob<256> >("blob256", max_n);
+
+  if (argc > 3)
+    write_json(argv[3]);
+  return 0;
+}
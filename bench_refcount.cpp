@@ -0,0 +1,44 @@
+/**
+ * bench_refcount compares the reference count policies of shared_ptr_vector
+ * on copying and clearing a large container.
+ *
+ * usage : bench_refcount [elements]   (default 10000000)
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <shared_ptr_vector.h>
+using namespace std;
+
+template<typename _Vec>
+void
+run(const char* name, size_t n)
+{
+  typedef chrono::steady_clock clock;
+
+  _Vec v1;
+  v1.reserve(n);
+  for (size_t i = 0; i < n; ++i)
+    v1.emplace_back(int(i));
+
+  auto t0 = clock::now();
+  _Vec v2(v1);
+  auto t1 = clock::now();
+  v2.clear();
+  auto t2 = clock::now();
+
+  double copy_ms  = chrono::duration<double, milli>(t1 - t0).count();
+  double clear_ms = chrono::duration<double, milli>(t2 - t1).count();
+  cout << name << " : copy " << copy_ms << " ms (" << copy_ms * 1e6 / n << " ns/elem)"
+       << ", clear " << clear_ms << " ms (" << clear_ms * 1e6 / n << " ns/elem)" << endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t n = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 10000000;
+  cout << "elements : " << n << endl;
+  run<shared_ptr_vector<int> >("shared_ptr_policy", n);
+  run<local_shared_ptr_vector<int> >("local_ptr_policy ", n);
+  return 0;
+}
@@ -0,0 +1,64 @@
+/**
+ * bench_spine compares the spine of shared_ptr_vector, which relocates
+ * slots bitwise, with a std::vector spine on push_back without reserve.
+ *
+ * usage : bench_spine [elements]   (default 100000000)
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <shared_ptr_vector.h>
+using namespace std;
+
+/// Not std::allocator, so shared_ptr_vector keeps a std::vector spine.
+template<typename _Tp>
+struct vector_spine_allocator
+: std::allocator<_Tp>
+{
+  template<typename _Up>
+  struct rebind { typedef vector_spine_allocator<_Up> other; };
+
+  vector_spine_allocator() { }
+  template<typename _Up>
+  vector_spine_allocator(const vector_spine_allocator<_Up>&) { }
+};
+
+template<typename _Vec>
+void
+run(const char* name, size_t n)
+{
+  typedef chrono::steady_clock clock;
+
+  shared_ptr<int> s = make_shared<int>(1);
+  _Vec v;
+  auto t0 = clock::now();
+  for (size_t i = 0; i < n; ++i)
+    v.push_back(typename _Vec::shared_data_type());
+  auto t1 = clock::now();
+  // the spine grows with slots which own elements
+  v.clear();
+  v.shrink_to_fit();
+  for (size_t i = 0; i < n / 10; ++i)
+    v.push_back(typename _Vec::shared_data_type(s));
+  auto t2 = clock::now();
+  v.clear();
+  v.shrink_to_fit();
+  for (size_t i = 0; i < n / 10; ++i)
+    v.push_back(typename _Vec::shared_data_type(s));
+  auto t3 = clock::now();
+
+  double null_ms  = chrono::duration<double, milli>(t1 - t0).count();
+  double owned_ms = chrono::duration<double, milli>(t3 - t2).count();
+  cout << name << " : push_back NULL " << null_ms << " ms (" << null_ms * 1e6 / n << " ns/elem)"
+       << ", push_back shared " << owned_ms << " ms (" << owned_ms * 1e7 / n << " ns/elem)" << endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t n = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 100000000;
+  cout << "elements : " << n << " (shared : " << n / 10 << ")" << endl;
+  run<shared_ptr_vector<int> >("shared_ptr_spine", n);
+  run<shared_ptr_vector<int, vector_spine_allocator<shared_ptr<int> > > >("std::vector     ", n);
+  return 0;
+}
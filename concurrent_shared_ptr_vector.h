@@ -0,0 +1,350 @@
+#ifndef _concurrent_shared_ptr_vector_h_
+#define _concurrent_shared_ptr_vector_h_
+
+/**
+ * concurrent_shared_ptr_vector is a shared_ptr_vector for concurrent appends
+ * author : dhan71@naver.com
+ */
+/**
+*  @brief  A vector of shared pointers to which many threads append at
+*  once, without locks.
+*
+*  @tparam _Tp  Type of element.
+*  @tparam _Policy  Ownership policy (see shared_ptr_policy).
+*  @tparam _First  Slots of the first segment, a power of two.
+*
+*  The slots live in segments which never move: segment 0 holds _First
+*  slots and segment k (k > 0) holds _First << (k - 1), so that the slots
+*  up to segment k are _First << k.  A segment is published with a
+*  compare-and-swap by the first thread which needs it.
+*
+*  push_back and emplace_back take a position with one fetch_add, fill the
+*  slot and mark it ready; they never wait for other threads.  size() is
+*  the length of the published prefix: the slots before it are all ready.
+*  operator[], at(), and iteration over [begin(), end()) read the
+*  published prefix and may run concurrently with the appends.
+*
+*  @Note Only appends and reads may run concurrently.  clear() and the
+*        destructor must not.  local_ptr_policy must not be used, since
+*        its counts are not atomic.  An element is ready when its
+*        push_back returns, but it is seen by size() only once the slots
+*        before it are ready too.
+*/
+
+#include <shared_ptr_vector.h>
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+template<typename _Tp, typename _Policy = typename default_ptr_policy<_Tp>::type, std::size_t _First = 1024>
+class concurrent_shared_ptr_vector
+{
+  static_assert(_First && !(_First & (_First - 1)), "_First must be a power of two");
+
+public:
+  typedef typename _Policy::pointer shared_data_type;
+
+  typedef _Tp                  value_type;
+  typedef _Tp*                 data_type;
+  typedef const _Tp*           const_data_type;
+  typedef data_type            reference;
+  typedef const_data_type      const_reference;
+  typedef std::size_t          size_type;
+  typedef std::ptrdiff_t       difference_type;
+
+  /**
+   *  A random access iterator over the slots.
+   */
+  class const_iterator
+  {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef shared_data_type                value_type;
+    typedef std::ptrdiff_t                  difference_type;
+    typedef const shared_data_type*         pointer;
+    typedef const shared_data_type&         reference;
+
+    const_iterator()
+    : iVec(nullptr)
+    , iPos(0)
+    { }
+
+    const_iterator(const concurrent_shared_ptr_vector* __v, size_type __n)
+    : iVec(__v)
+    , iPos(__n)
+    { }
+
+    reference operator*() const { return iVec->slot(iPos); }
+    pointer operator->() const { return &iVec->slot(iPos); }
+    reference operator[](difference_type __n) const { return iVec->slot(iPos + __n); }
+
+    const_iterator& operator++() { ++iPos; return *this; }
+    const_iterator operator++(int) { const_iterator __r(*this); ++iPos; return __r; }
+    const_iterator& operator--() { --iPos; return *this; }
+    const_iterator operator--(int) { const_iterator __r(*this); --iPos; return __r; }
+    const_iterator& operator+=(difference_type __n) { iPos += __n; return *this; }
+    const_iterator& operator-=(difference_type __n) { iPos -= __n; return *this; }
+    const_iterator operator+(difference_type __n) const { return const_iterator(iVec, iPos + __n); }
+    const_iterator operator-(difference_type __n) const { return const_iterator(iVec, iPos - __n); }
+    difference_type operator-(const const_iterator& __x) const { return difference_type(iPos) - difference_type(__x.iPos); }
+
+    bool operator==(const const_iterator& __x) const { return iPos == __x.iPos; }
+    bool operator!=(const const_iterator& __x) const { return iPos != __x.iPos; }
+    bool operator<(const const_iterator& __x) const { return iPos < __x.iPos; }
+    bool operator>(const const_iterator& __x) const { return iPos > __x.iPos; }
+    bool operator<=(const const_iterator& __x) const { return iPos <= __x.iPos; }
+    bool operator>=(const const_iterator& __x) const { return iPos >= __x.iPos; }
+
+  private:
+    const concurrent_shared_ptr_vector* iVec;
+    size_type                           iPos;
+  };
+  typedef const_iterator iterator;
+
+public:
+  /**
+   *  @brief  Creates a concurrent_shared_ptr_vector with no elements.
+   */
+  concurrent_shared_ptr_vector()
+  { }
+
+  concurrent_shared_ptr_vector(const concurrent_shared_ptr_vector&) = delete;
+  concurrent_shared_ptr_vector& operator=(const concurrent_shared_ptr_vector&) = delete;
+
+  ~concurrent_shared_ptr_vector()
+  {
+    _M_free();
+  }
+
+public:
+  // appends, from any thread
+  /**
+   *  @brief  Add data to the end of the concurrent_shared_ptr_vector.
+   *  @param  __x  Data to be added, owned afterwards.
+   *  @return  Position of the data.
+   */
+  size_type
+  push_back(const data_type& __x)
+  { return _M_append(shared_data_type(__x)); }
+
+  /**
+   *  @brief  Moves a shared_data_type to the end.
+   *  @param  __x  A shared_data_type, empty afterwards.
+   *  @return  Position of the data.
+   */
+  size_type
+  push_back(shared_data_type&& __x)
+  { return _M_append(std::move(__x)); }
+
+  /**
+   *  @brief  Add a copy of a value to the end.
+   *  @param  __x  Value to be copied.
+   *  @return  Position of the copy.
+   */
+  size_type
+  push_back(const value_type& __x)
+  { return _M_append(_Policy::make(__x)); }
+
+  /**
+   *  @brief  Constructs an object at the end.
+   *  @param  __args  Arguments forwarded to the constructor of _Tp.
+   *  @return  Pointer to the constructed object.
+   */
+  template<typename... _Args>
+  reference
+  emplace_back(_Args&&... __args)
+  {
+    shared_data_type __p(_Policy::make(std::forward<_Args>(__args)...));
+    reference __r = __p.get();
+    _M_append(std::move(__p));
+    return __r;
+  }
+
+public:
+  // reads of the published prefix, from any thread
+  /**  Returns the number of published slots.  */
+  size_type
+  size() const
+  { return iPublished.load(std::memory_order_acquire); }
+
+  bool
+  empty() const
+  { return size() == 0; }
+
+  /**  Returns the number of slots taken, published or not.  */
+  size_type
+  reserved() const
+  { return iReserved.load(std::memory_order_relaxed); }
+
+  const_iterator
+  begin() const
+  { return const_iterator(this, 0); }
+
+  /**  Returns the end of the prefix published at the time of the call.  */
+  const_iterator
+  end() const
+  { return const_iterator(this, size()); }
+
+  /**
+   *  @brief  Subscript access to the data of the concurrent_shared_ptr_vector.
+   *  @param  __n  The index of the element, less than size().
+   *  @return  Pointer to data.
+   */
+  reference
+  operator[](size_type __n) const
+  { return slot(__n).get(); }
+
+  /**
+   *  @brief  Provides access to the data of the concurrent_shared_ptr_vector.
+   *  @param  __n  The index of the element.
+   *  @return  Pointer to data.
+   *  @throw  std::out_of_range  If @a __n is not less than size().
+   */
+  reference
+  at(size_type __n) const
+  {
+    if (__n >= size())
+      throw std::out_of_range("concurrent_shared_ptr_vector::at");
+    return slot(__n).get();
+  }
+
+  /**  Returns the slot at @a __n, which must be less than size().  */
+  const shared_data_type&
+  slot(size_type __n) const
+  {
+    size_type __o;
+    const unsigned __k = _S_segment(__n, __o);
+    return iSegments[__k].load(std::memory_order_acquire)[__o].slot;
+  }
+
+public:
+  // not concurrent
+  /**
+   *  Erases all the elements.  No other thread may use the
+   *  concurrent_shared_ptr_vector meanwhile.
+   */
+  void
+  clear()
+  {
+    _M_free();
+    iReserved.store(0, std::memory_order_relaxed);
+    iPublished.store(0, std::memory_order_release);
+  }
+
+  /**
+   *  @brief  Copies the published elements into a shared_ptr_vector.
+   *  @return  A shared_ptr_vector sharing the elements.
+   */
+  shared_ptr_vector<_Tp, std::allocator<shared_data_type>, _Policy>
+  to_shared_ptr_vector() const
+  {
+    shared_ptr_vector<_Tp, std::allocator<shared_data_type>, _Policy> __r;
+    const size_type __n = size();
+    __r.reserve(__n);
+    for (size_type __i = 0; __i < __n; ++__i)
+      __r.push_back(shared_data_type(slot(__i)));
+    return __r;
+  }
+
+private:
+  struct _Cell
+  {
+    shared_data_type  slot;
+    std::atomic<bool> ready{false};
+  };
+
+  static constexpr unsigned _S_max_segments = 64;
+
+  static size_type
+  _S_capacity(unsigned __k)
+  { return __k ? _First << (__k - 1) : _First; }
+
+  // segment of __n, and the offset in it
+  static unsigned
+  _S_segment(size_type __n, size_type& __off)
+  {
+    const size_type __q = __n / _First;
+    if (__q == 0)
+    {
+      __off = __n;
+      return 0;
+    }
+#if defined(__GNUC__)
+    const unsigned __k = sizeof(unsigned long long) * 8 - __builtin_clzll(__q);
+#else
+    unsigned __k = 1;
+    for (size_type __b = __q; __b > 1; __b >>= 1)
+      ++__k;
+#endif
+    __off = __n - (_First << (__k - 1));
+    return __k;
+  }
+
+  _Cell*
+  _M_cells(unsigned __k)
+  {
+    _Cell* __s = iSegments[__k].load(std::memory_order_acquire);
+    if (!__s)
+    {
+      // the first thread to publish its segment wins
+      _Cell* __new = new _Cell[_S_capacity(__k)];
+      if (iSegments[__k].compare_exchange_strong(__s, __new, std::memory_order_acq_rel, std::memory_order_acquire))
+        __s = __new;
+      else
+        delete[] __new;
+    }
+    return __s;
+  }
+
+  size_type
+  _M_append(shared_data_type&& __p)
+  {
+    const size_type __n = iReserved.fetch_add(1, std::memory_order_relaxed);
+    size_type __o;
+    const unsigned __k = _S_segment(__n, __o);
+    _Cell& __c = _M_cells(__k)[__o];
+    __c.slot = std::move(__p);
+    // seq_cst with the loads of _M_publish, so that a thread which sees
+    // this slot not ready leaves the publishing to this one
+    __c.ready.store(true);
+    _M_publish(__n);
+    return __n;
+  }
+
+  // moves the published size past the ready slot __p and those after it
+  void
+  _M_publish(size_type __p)
+  {
+    for (;;)
+    {
+      size_type __e = __p;
+      if (!iPublished.compare_exchange_strong(__e, __p + 1))
+        // below __p: the slot at __e is not ready yet, and its thread
+        // will publish this one; past __p: done by another thread
+        return;
+      if (++__p >= iReserved.load(std::memory_order_acquire))
+        return;
+      size_type __o;
+      const unsigned __k = _S_segment(__p, __o);
+      _Cell* __s = iSegments[__k].load(std::memory_order_acquire);
+      if (!__s || !__s[__o].ready.load())
+        return;
+    }
+  }
+
+  void
+  _M_free()
+  {
+    for (unsigned __k = 0; __k < _S_max_segments; ++__k)
+      delete[] iSegments[__k].exchange(nullptr, std::memory_order_relaxed);
+  }
+
+  std::atomic<_Cell*>    iSegments[_S_max_segments] = { };
+  std::atomic<size_type> iReserved{0};
+  std::atomic<size_type> iPublished{0};
+};
+
+#endif /* _concurrent_shared_ptr_vector_h_ */
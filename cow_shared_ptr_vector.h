@@ -0,0 +1,141 @@
+#ifndef _cow_shared_ptr_vector_h_
+#define _cow_shared_ptr_vector_h_
+
+/**
+ * cow_shared_ptr_vector is a shared_ptr_vector with copy-on-write snapshots
+ * author : dhan71@naver.com
+ */
+/**
+*  @brief  A shared_ptr_vector with one writer and many readers, which
+*  read immutable snapshots.
+*
+*  @tparam _Tp  Type of element.
+*  @tparam _Alloc  Allocator type of the shared_ptr_vector.
+*  @tparam _Policy  Ownership policy of the shared_ptr_vector.
+*
+*  snapshot() and load() return a handle to a version of the elements in
+*  O(1), without copying the slots.  The writer changes the elements
+*  through write(), which copies the slots (O(n) count increments) only
+*  when a snapshot of the current version is still held, and at most once
+*  per version: writes between two snapshots go to the same copy.
+*
+*  The writer publishes a version with publish(); readers on any thread
+*  take the last published version with load(), and keep it as long as
+*  they hold the handle.
+*
+*  @Note read(), write(), snapshot() and publish() belong to the writer
+*        thread.  load() may be called from any thread, and so may the
+*        const members of a snapshot, find() on an index too.  The
+*        elements are shared by the versions, so they should not be
+*        changed in place while snapshots are held; replace them instead.
+*/
+
+#include <shared_ptr_vector.h>
+
+#include <atomic>
+#include <memory>
+
+template<typename _Tp, typename _Alloc = std::allocator<std::shared_ptr<_Tp> >, typename _Policy = typename default_ptr_policy<_Tp>::type>
+class cow_shared_ptr_vector
+{
+public:
+  typedef shared_ptr_vector<_Tp, _Alloc, _Policy> base_type;
+  typedef std::shared_ptr<const base_type>        snapshot_type;
+
+  typedef typename base_type::value_type       value_type;
+  typedef typename base_type::data_type        data_type;
+  typedef typename base_type::shared_data_type shared_data_type;
+  typedef typename base_type::size_type        size_type;
+
+public:
+  /**
+   *  @brief  Creates a cow_shared_ptr_vector with no elements.
+   */
+  cow_shared_ptr_vector()
+  : iList(std::make_shared<base_type>())
+  { }
+
+  /**
+   *  @brief  Creates a cow_shared_ptr_vector from a shared_ptr_vector.
+   *  @param  __x  The first version, which is neither copied nor published.
+   */
+  explicit
+  cow_shared_ptr_vector(base_type __x)
+  : iList(std::make_shared<base_type>(std::move(__x)))
+  { }
+
+  cow_shared_ptr_vector(const cow_shared_ptr_vector&) = delete;
+  cow_shared_ptr_vector& operator=(const cow_shared_ptr_vector&) = delete;
+
+public:
+  // writer
+  /**  Returns the current version, for reading on the writer thread.  */
+  const base_type&
+  read() const
+  { return *iList; }
+
+  /**
+   *  @brief  Gives the current version for writing.
+   *  @return  A shared_ptr_vector which no snapshot shares.
+   *
+   *  If a snapshot of the current version is held, the slots are copied
+   *  first and the copy becomes the current version.  The reference is
+   *  valid until the next snapshot().
+   */
+  base_type&
+  write()
+  {
+    if (iList.use_count() > 1)
+      _M_clone();
+    // a reader which dropped the last snapshot is done with it
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return *iList;
+  }
+
+  /**
+   *  @brief  Takes a snapshot of the current version, in O(1).
+   *  @return  A handle to the current version, which the writer will not
+   *           change.
+   */
+  snapshot_type
+  snapshot() const
+  { return iList; }
+
+  /**
+   *  @brief  Makes the current version the one load() returns, in O(1).
+   */
+  void
+  publish()
+  { std::atomic_store_explicit(&iPublished, snapshot(), std::memory_order_release); }
+
+  /**  Returns true if a snapshot of the current version is held.  */
+  bool
+  shared() const
+  { return iList.use_count() > 1; }
+
+public:
+  // readers
+  /**
+   *  @brief  Takes the last published version, from any thread.
+   *  @return  A handle to it, or an empty handle before the first publish().
+   */
+  snapshot_type
+  load() const
+  { return std::atomic_load_explicit(&iPublished, std::memory_order_acquire); }
+
+private:
+  void
+  _M_clone()
+  {
+    std::shared_ptr<base_type> __c = std::make_shared<base_type>(*iList);
+    if (iList->indexed())
+      __c->enable_index();
+    __c->set_reclaimer(iList->reclaimer());
+    iList = std::move(__c);
+  }
+
+  std::shared_ptr<base_type> iList;
+  snapshot_type              iPublished;
+};
+
+#endif /* _cow_shared_ptr_vector_h_ */
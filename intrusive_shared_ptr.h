@@ -0,0 +1,167 @@
+#ifndef _intrusive_shared_ptr_h_
+#define _intrusive_shared_ptr_h_
+
+/**
+ * intrusive_shared_ptr is a shared pointer to objects with their own count
+ * author : dhan71@naver.com
+ */
+/**
+*  @brief  A reference counted pointer for objects which embed their own
+*  reference count.
+*
+*  @tparam _Tp  Type of the pointee.
+*
+*  The count is kept by the pointee through two functions found by
+*  argument dependent lookup:
+*
+*    void intrusive_add_ref(_Tp*);   // count up
+*    void intrusive_release(_Tp*);   // count down, free at zero
+*
+*  An intrusive_shared_ptr is a single pointer, half the size of a
+*  std::shared_ptr, and needs no separate control block.  It offers the
+*  part of std::shared_ptr which shared_ptr_vector uses.
+*/
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+/**
+ *  True if intrusive_add_ref and intrusive_release are found for _Tp*.
+ */
+template<typename _Tp, typename = void>
+struct has_intrusive_ref_count
+: std::false_type
+{ };
+
+template<typename _Tp>
+struct has_intrusive_ref_count<_Tp, std::void_t<decltype(intrusive_add_ref(std::declval<_Tp*>())),
+                                                decltype(intrusive_release(std::declval<_Tp*>()))> >
+: std::true_type
+{ };
+
+template<typename _Tp>
+class intrusive_shared_ptr
+{
+public:
+  typedef _Tp element_type;
+
+  constexpr
+  intrusive_shared_ptr() noexcept
+  : iPtr(nullptr)
+  { }
+
+  constexpr
+  intrusive_shared_ptr(std::nullptr_t) noexcept
+  : iPtr(nullptr)
+  { }
+
+  /**
+   *  @brief  Shares @a __p, counting it up.
+   *  @param  __p  A pointer, or NULL.
+   */
+  explicit
+  intrusive_shared_ptr(_Tp* __p)
+  : iPtr(__p)
+  {
+    if (iPtr)
+      intrusive_add_ref(iPtr);
+  }
+
+  intrusive_shared_ptr(const intrusive_shared_ptr& __x)
+  : iPtr(__x.iPtr)
+  {
+    if (iPtr)
+      intrusive_add_ref(iPtr);
+  }
+
+  intrusive_shared_ptr(intrusive_shared_ptr&& __x) noexcept
+  : iPtr(__x.iPtr)
+  {
+    __x.iPtr = nullptr;
+  }
+
+  ~intrusive_shared_ptr()
+  {
+    if (iPtr)
+      intrusive_release(iPtr);
+  }
+
+  intrusive_shared_ptr&
+  operator=(const intrusive_shared_ptr& __x)
+  {
+    intrusive_shared_ptr(__x).swap(*this);
+    return *this;
+  }
+
+  intrusive_shared_ptr&
+  operator=(intrusive_shared_ptr&& __x) noexcept
+  {
+    intrusive_shared_ptr(std::move(__x)).swap(*this);
+    return *this;
+  }
+
+  void
+  reset()
+  {
+    intrusive_shared_ptr().swap(*this);
+  }
+
+  void
+  reset(_Tp* __p)
+  {
+    intrusive_shared_ptr(__p).swap(*this);
+  }
+
+  void
+  swap(intrusive_shared_ptr& __x) noexcept
+  {
+    std::swap(iPtr, __x.iPtr);
+  }
+
+  _Tp*
+  get() const noexcept
+  { return iPtr; }
+
+  _Tp&
+  operator*() const noexcept
+  { return *iPtr; }
+
+  _Tp*
+  operator->() const noexcept
+  { return iPtr; }
+
+  explicit
+  operator bool() const noexcept
+  { return iPtr != nullptr; }
+
+private:
+  _Tp* iPtr;
+};
+
+template<typename _Tp, typename _Up>
+inline bool
+operator==(const intrusive_shared_ptr<_Tp>& __x, const intrusive_shared_ptr<_Up>& __y) noexcept
+{ return __x.get() == __y.get(); }
+
+template<typename _Tp, typename _Up>
+inline bool
+operator!=(const intrusive_shared_ptr<_Tp>& __x, const intrusive_shared_ptr<_Up>& __y) noexcept
+{ return __x.get() != __y.get(); }
+
+template<typename _Tp>
+inline bool
+operator==(const intrusive_shared_ptr<_Tp>& __x, std::nullptr_t) noexcept
+{ return !__x; }
+
+template<typename _Tp>
+inline bool
+operator!=(const intrusive_shared_ptr<_Tp>& __x, std::nullptr_t) noexcept
+{ return (bool)__x; }
+
+template<typename _Tp>
+inline void
+swap(intrusive_shared_ptr<_Tp>& __x, intrusive_shared_ptr<_Tp>& __y) noexcept
+{ __x.swap(__y); }
+
+#endif /* _intrusive_shared_ptr_h_ */
@@ -0,0 +1,278 @@
+#ifndef _local_shared_ptr_h_
+#define _local_shared_ptr_h_
+
+/**
+ * local_shared_ptr is a shared pointer with a non-atomic reference count
+ * author : dhan71@naver.com
+ */
+/**
+*  @brief  A reference counted pointer for objects used by one thread.
+*
+*  @tparam _Tp  Type of the pointee.
+*
+*  local_shared_ptr offers the part of std::shared_ptr which
+*  shared_ptr_vector uses (get(), bool test, reset(), use_count(), copy
+*  and move), but its reference count is a plain integer, so copies and
+*  releases are not lock-prefixed instructions.
+*
+*  A local_shared_ptr and all its copies must be used by one thread at a
+*  time.
+*/
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+template<typename _Tp>
+class local_shared_ptr
+{
+public:
+  typedef _Tp element_type;
+
+private:
+  struct _Ctrl
+  {
+    long iCount = 1;
+
+    virtual ~_Ctrl() { }
+    // destroys the pointee
+    virtual void _M_dispose() noexcept = 0;
+    // destroys and frees the control block
+    virtual void _M_destroy() noexcept = 0;
+  };
+
+  // control block of an adopted pointer
+  struct _Ctrl_ptr : _Ctrl
+  {
+    explicit
+    _Ctrl_ptr(_Tp* __p)
+    : iPtr(__p)
+    { }
+
+    void _M_dispose() noexcept { delete iPtr; }
+    void _M_destroy() noexcept { delete this; }
+
+    _Tp* iPtr;
+  };
+
+  // control block with the pointee in it
+  template<typename _Alloc>
+  struct _Ctrl_inplace : _Ctrl
+  {
+    typedef typename std::allocator_traits<_Alloc>::template rebind_alloc<_Ctrl_inplace> _Self_alloc;
+
+    explicit
+    _Ctrl_inplace(const _Alloc& __a)
+    : iAlloc(__a)
+    { }
+
+    _Tp* _M_ptr() noexcept { return reinterpret_cast<_Tp*>(&iStorage); }
+
+    void _M_dispose() noexcept { _M_ptr()->~_Tp(); }
+    void _M_destroy() noexcept
+    {
+      _Self_alloc __a(iAlloc);
+      this->~_Ctrl_inplace();
+      std::allocator_traits<_Self_alloc>::deallocate(__a, this, 1);
+    }
+
+    _Self_alloc iAlloc;
+    typename std::aligned_storage<sizeof(_Tp), alignof(_Tp)>::type iStorage;
+  };
+
+public:
+  constexpr
+  local_shared_ptr() noexcept
+  : iPtr(nullptr)
+  , iCtrl(nullptr)
+  { }
+
+  constexpr
+  local_shared_ptr(std::nullptr_t) noexcept
+  : iPtr(nullptr)
+  , iCtrl(nullptr)
+  { }
+
+  /**
+   *  @brief  Takes ownership of @a __p.
+   *  @param  __p  A pointer allocated by new, or NULL.
+   */
+  explicit
+  local_shared_ptr(_Tp* __p)
+  : iPtr(__p)
+  , iCtrl(nullptr)
+  {
+    if (__p)
+    {
+      try
+      {
+        iCtrl = new _Ctrl_ptr(__p);
+      }
+      catch (...)
+      {
+        delete __p;
+        throw;
+      }
+    }
+  }
+
+  local_shared_ptr(const local_shared_ptr& __x) noexcept
+  : iPtr(__x.iPtr)
+  , iCtrl(__x.iCtrl)
+  {
+    if (iCtrl)
+      ++iCtrl->iCount;
+  }
+
+  local_shared_ptr(local_shared_ptr&& __x) noexcept
+  : iPtr(__x.iPtr)
+  , iCtrl(__x.iCtrl)
+  {
+    __x.iPtr = nullptr;
+    __x.iCtrl = nullptr;
+  }
+
+  ~local_shared_ptr()
+  {
+    _M_release();
+  }
+
+  local_shared_ptr&
+  operator=(const local_shared_ptr& __x) noexcept
+  {
+    local_shared_ptr(__x).swap(*this);
+    return *this;
+  }
+
+  local_shared_ptr&
+  operator=(local_shared_ptr&& __x) noexcept
+  {
+    local_shared_ptr(std::move(__x)).swap(*this);
+    return *this;
+  }
+
+  void
+  reset() noexcept
+  {
+    local_shared_ptr().swap(*this);
+  }
+
+  void
+  reset(_Tp* __p)
+  {
+    local_shared_ptr(__p).swap(*this);
+  }
+
+  void
+  swap(local_shared_ptr& __x) noexcept
+  {
+    std::swap(iPtr, __x.iPtr);
+    std::swap(iCtrl, __x.iCtrl);
+  }
+
+  _Tp*
+  get() const noexcept
+  { return iPtr; }
+
+  _Tp&
+  operator*() const noexcept
+  { return *iPtr; }
+
+  _Tp*
+  operator->() const noexcept
+  { return iPtr; }
+
+  explicit
+  operator bool() const noexcept
+  { return iPtr != nullptr; }
+
+  long
+  use_count() const noexcept
+  { return iCtrl ? iCtrl->iCount : 0; }
+
+  /**
+   *  @brief  Creates an object and its reference count in one allocation.
+   *  @param  __a  An allocator for the allocation.
+   *  @param  __args  Arguments forwarded to the constructor of _Tp.
+   */
+  template<typename _Alloc, typename... _Args>
+  static local_shared_ptr
+  allocate(const _Alloc& __a, _Args&&... __args)
+  {
+    typedef _Ctrl_inplace<_Alloc> _Block;
+    typename _Block::_Self_alloc __ba(__a);
+    _Block* __b = std::allocator_traits<typename _Block::_Self_alloc>::allocate(__ba, 1);
+    ::new (__b) _Block(__a);
+    try
+    {
+      ::new (static_cast<void*>(__b->_M_ptr())) _Tp(std::forward<_Args>(__args)...);
+    }
+    catch (...)
+    {
+      __b->_M_destroy();
+      throw;
+    }
+    local_shared_ptr __r;
+    __r.iPtr = __b->_M_ptr();
+    __r.iCtrl = __b;
+    return __r;
+  }
+
+private:
+  void
+  _M_release() noexcept
+  {
+    if (iCtrl && --iCtrl->iCount == 0)
+    {
+      iCtrl->_M_dispose();
+      iCtrl->_M_destroy();
+    }
+  }
+
+  _Tp*   iPtr;
+  _Ctrl* iCtrl;
+};
+
+/// Same as std::make_shared but for local_shared_ptr.
+template<typename _Tp, typename... _Args>
+inline local_shared_ptr<_Tp>
+make_local_shared(_Args&&... __args)
+{
+  return local_shared_ptr<_Tp>::allocate(std::allocator<_Tp>(), std::forward<_Args>(__args)...);
+}
+
+/// Same as std::allocate_shared but for local_shared_ptr.
+template<typename _Tp, typename _Alloc, typename... _Args>
+inline local_shared_ptr<_Tp>
+allocate_local_shared(const _Alloc& __a, _Args&&... __args)
+{
+  return local_shared_ptr<_Tp>::allocate(__a, std::forward<_Args>(__args)...);
+}
+
+template<typename _Tp, typename _Up>
+inline bool
+operator==(const local_shared_ptr<_Tp>& __x, const local_shared_ptr<_Up>& __y) noexcept
+{ return __x.get() == __y.get(); }
+
+template<typename _Tp, typename _Up>
+inline bool
+operator!=(const local_shared_ptr<_Tp>& __x, const local_shared_ptr<_Up>& __y) noexcept
+{ return __x.get() != __y.get(); }
+
+template<typename _Tp>
+inline bool
+operator==(const local_shared_ptr<_Tp>& __x, std::nullptr_t) noexcept
+{ return !__x; }
+
+template<typename _Tp>
+inline bool
+operator!=(const local_shared_ptr<_Tp>& __x, std::nullptr_t) noexcept
+{ return (bool)__x; }
+
+template<typename _Tp>
+inline void
+swap(local_shared_ptr<_Tp>& __x, local_shared_ptr<_Tp>& __y) noexcept
+{ __x.swap(__y); }
+
+#endif /* _local_shared_ptr_h_ */
@@ -0,0 +1,414 @@
+#ifndef _mapped_shared_ptr_vector_h_
+#define _mapped_shared_ptr_vector_h_
+
+/**
+ * mapped_shared_ptr_vector is a read-only shared_ptr_vector in a mapped file
+ * author : dhan71@naver.com
+ */
+/**
+*  @brief  A read-only vector of elements which stay in a memory-mapped
+*  file, without a copy.
+*
+*  @tparam _Tp  Type of element, trivially copyable.
+*
+*  write() saves a shared_ptr_vector in a layout which can be mapped as it
+*  is: a header, one 64-bit entry per slot (0 for NULL, k for the k-th
+*  element) and the elements, each once, aligned for _Tp.  The
+*  constructor maps such a file read-only; the pages of the elements are
+*  read when they are first touched, so opening reads only the header and
+*  the slot entries.  Both are checked when the file is opened: the header
+*  against the file size, and each entry against the number of elements,
+*  so that no access goes past the mapping.
+*
+*  operator[], at() and the iterators give const pointers into the
+*  mapping.  slot() gives a std::shared_ptr which aliases the mapping:
+*  all of them share one control block, which keeps the file mapped as
+*  long as one is held, even after the mapped_shared_ptr_vector is gone.
+*  Slots which shared an element when written point at the same element.
+*
+*  @Note The file is in the byte order and layout of the machine which
+*        wrote it.  It must not be changed while it is mapped.
+*/
+
+#include <shared_ptr_vector.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+template<typename _Tp>
+class mapped_shared_ptr_vector
+{
+  static_assert(std::is_trivially_copyable<_Tp>::value, "_Tp must be trivially copyable");
+
+public:
+  typedef std::shared_ptr<const _Tp> shared_data_type;
+
+  typedef _Tp                  value_type;
+  typedef const _Tp*           data_type;
+  typedef const _Tp*           const_data_type;
+  typedef const_data_type      reference;
+  typedef const_data_type      const_reference;
+  typedef std::size_t          size_type;
+  typedef std::ptrdiff_t       difference_type;
+
+  /**
+   *  A random access iterator over the slots, which gives const pointers.
+   */
+  class const_iterator
+  {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef const_data_type                 value_type;
+    typedef std::ptrdiff_t                  difference_type;
+    typedef void                            pointer;
+    typedef const_data_type                 reference;
+
+    const_iterator()
+    : iVec(nullptr)
+    , iPos(0)
+    { }
+
+    const_iterator(const mapped_shared_ptr_vector* __v, size_type __n)
+    : iVec(__v)
+    , iPos(__n)
+    { }
+
+    reference operator*() const { return (*iVec)[iPos]; }
+    reference operator[](difference_type __n) const { return (*iVec)[iPos + __n]; }
+
+    const_iterator& operator++() { ++iPos; return *this; }
+    const_iterator operator++(int) { const_iterator __r(*this); ++iPos; return __r; }
+    const_iterator& operator--() { --iPos; return *this; }
+    const_iterator operator--(int) { const_iterator __r(*this); --iPos; return __r; }
+    const_iterator& operator+=(difference_type __n) { iPos += __n; return *this; }
+    const_iterator& operator-=(difference_type __n) { iPos -= __n; return *this; }
+    const_iterator operator+(difference_type __n) const { return const_iterator(iVec, iPos + __n); }
+    const_iterator operator-(difference_type __n) const { return const_iterator(iVec, iPos - __n); }
+    difference_type operator-(const const_iterator& __x) const { return difference_type(iPos) - difference_type(__x.iPos); }
+
+    bool operator==(const const_iterator& __x) const { return iPos == __x.iPos; }
+    bool operator!=(const const_iterator& __x) const { return iPos != __x.iPos; }
+    bool operator<(const const_iterator& __x) const { return iPos < __x.iPos; }
+    bool operator>(const const_iterator& __x) const { return iPos > __x.iPos; }
+    bool operator<=(const const_iterator& __x) const { return iPos <= __x.iPos; }
+    bool operator>=(const const_iterator& __x) const { return iPos >= __x.iPos; }
+
+  private:
+    const mapped_shared_ptr_vector* iVec;
+    size_type                       iPos;
+  };
+  typedef const_iterator iterator;
+
+public:
+  /**
+   *  @brief  Creates a mapped_shared_ptr_vector with no elements.
+   */
+  mapped_shared_ptr_vector()
+  : iSlots(nullptr)
+  , iData(nullptr)
+  , iSize(0)
+  { }
+
+  /**
+   *  @brief  Maps a file saved by write().
+   *  @param  __path  Path of the file.
+   *  @throw  std::system_error  If the file cannot be opened or mapped.
+   *  @throw  std::runtime_error  If the file is not from write() for _Tp,
+   *          or a slot refers past the elements.
+   */
+  explicit
+  mapped_shared_ptr_vector(const char* __path)
+  : mapped_shared_ptr_vector()
+  {
+    const int __fd = ::open(__path, O_RDONLY | O_CLOEXEC);
+    if (__fd < 0)
+      throw std::system_error(errno, std::generic_category(), "mapped_shared_ptr_vector: open");
+    struct stat __st;
+    if (::fstat(__fd, &__st) != 0)
+    {
+      const int __e = errno;
+      ::close(__fd);
+      throw std::system_error(__e, std::generic_category(), "mapped_shared_ptr_vector: fstat");
+    }
+    const std::size_t __len = std::size_t(__st.st_size);
+    if (__len < sizeof(_Header))
+    {
+      ::close(__fd);
+      throw std::runtime_error("mapped_shared_ptr_vector: file too short");
+    }
+    void* __p = ::mmap(nullptr, __len, PROT_READ, MAP_PRIVATE, __fd, 0);
+    const int __e = errno;
+    ::close(__fd);
+    if (__p == MAP_FAILED)
+      throw std::system_error(__e, std::generic_category(), "mapped_shared_ptr_vector: mmap");
+    iMap = std::make_shared<_Mapping>(__p, __len);
+    _M_check();
+  }
+
+  mapped_shared_ptr_vector(const mapped_shared_ptr_vector&) = default;
+  mapped_shared_ptr_vector& operator=(const mapped_shared_ptr_vector&) = default;
+
+public:
+  /**
+   *  @brief  Saves a shared_ptr_vector in the layout the constructor maps.
+   *  @param  __w  A writer with write(const char*, size), a std::ostream
+   *               for example.
+   *  @param  __x  The shared_ptr_vector to save.
+   */
+  template<typename _Writer, typename _Alloc, typename _Policy>
+  static void
+  write(_Writer& __w, const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x)
+  {
+    // number the elements, each once
+    std::unordered_map<const _Tp*, std::uint64_t> __ids;
+    std::vector<std::uint64_t> __slots;
+    std::vector<const _Tp*> __objs;
+    __slots.reserve(__x.size());
+    for (auto __i = __x.begin(); __i != __x.end(); ++__i)
+    {
+      const _Tp* __p = __i->get();
+      if (!__p)
+      {
+        __slots.push_back(0);
+        continue;
+      }
+      auto __r = __ids.emplace(__p, __objs.size() + 1);
+      if (__r.second)
+        __objs.push_back(__p);
+      __slots.push_back(__r.first->second);
+    }
+
+    _Header __h;
+    std::memcpy(__h.magic, _S_magic, sizeof(__h.magic));
+    __h.type_size = std::uint32_t(sizeof(_Tp));
+    __h.type_align = std::uint32_t(alignof(_Tp));
+    __h.reserved = 0;
+    __h.size = __slots.size();
+    __h.count = __objs.size();
+    __w.write(reinterpret_cast<const char*>(&__h), sizeof(__h));
+    __w.write(reinterpret_cast<const char*>(__slots.data()), __slots.size() * sizeof(std::uint64_t));
+    static const char __pad[alignof(_Tp)] = { };
+    const std::size_t __at = sizeof(_Header) + __slots.size() * sizeof(std::uint64_t);
+    __w.write(__pad, _S_data_offset(__slots.size()) - __at);
+    for (const _Tp* __p : __objs)
+      __w.write(reinterpret_cast<const char*>(__p), sizeof(_Tp));
+  }
+
+public:
+  // reads
+  size_type
+  size() const
+  { return iSize; }
+
+  bool
+  empty() const
+  { return iSize == 0; }
+
+  /**  Returns the number of distinct elements in the file.  */
+  size_type
+  count() const
+  { return iMap ? size_type(_M_header().count) : 0; }
+
+  const_iterator
+  begin() const
+  { return const_iterator(this, 0); }
+
+  const_iterator
+  end() const
+  { return const_iterator(this, iSize); }
+
+  /**
+   *  @brief  Subscript access to the data of the mapped_shared_ptr_vector.
+   *  @param  __n  The index of the element, less than size().
+   *  @return  Pointer into the mapping, or NULL for a NULL slot.
+   */
+  const_reference
+  operator[](size_type __n) const
+  {
+    const std::uint64_t __k = iSlots[__n];
+    return __k ? iData + (__k - 1) : nullptr;
+  }
+
+  /**
+   *  @brief  Provides access to the data of the mapped_shared_ptr_vector.
+   *  @param  __n  The index of the element.
+   *  @return  Pointer into the mapping, or NULL for a NULL slot.
+   *  @throw  std::out_of_range  If @a __n is not less than size().
+   */
+  const_reference
+  at(size_type __n) const
+  {
+    if (__n >= iSize)
+      throw std::out_of_range("mapped_shared_ptr_vector::at");
+    return (*this)[__n];
+  }
+
+  const_reference
+  front() const
+  { return (*this)[0]; }
+
+  const_reference
+  back() const
+  { return (*this)[iSize - 1]; }
+
+  /**
+   *  @brief  Returns the slot at @a __n as a shared_ptr.
+   *  @param  __n  The index of the element, less than size().
+   *  @return  A shared_ptr aliasing the mapping, empty for a NULL slot.
+   *
+   *  No memory is allocated: the shared_ptr shares the control block of
+   *  the mapping.
+   */
+  shared_data_type
+  slot(size_type __n) const
+  {
+    const_data_type __p = (*this)[__n];
+    return __p ? shared_data_type(iMap, __p) : shared_data_type();
+  }
+
+  /**
+   *  @brief  Copies the slots into a shared_ptr_vector.
+   *  @return  A shared_ptr_vector whose elements are copies of those in
+   *           the mapping; slots which shared an element share its copy.
+   */
+  shared_ptr_vector<_Tp>
+  to_shared_ptr_vector() const
+  {
+    shared_ptr_vector<_Tp> __r;
+    __r.reserve(iSize);
+    std::vector<typename shared_ptr_vector<_Tp>::shared_data_type> __objs(count());
+    for (size_type __i = 0; __i < iSize; ++__i)
+    {
+      const std::uint64_t __k = iSlots[__i];
+      if (!__k)
+      {
+        __r.push_back(typename shared_ptr_vector<_Tp>::shared_data_type());
+        continue;
+      }
+      auto& __o = __objs[__k - 1];
+      if (!__o)
+        __o = std::make_shared<_Tp>(iData[__k - 1]);
+      __r.push_back(typename shared_ptr_vector<_Tp>::shared_data_type(__o));
+    }
+    return __r;
+  }
+
+public:
+  // find functions, as in shared_ptr_vector
+  const_iterator
+  find(const_data_type __x) const
+  {
+    for (size_type __i = 0; __i < iSize; ++__i)
+      if ((*this)[__i] == __x)
+        return begin() + __i;
+    return end();
+  }
+
+  const_iterator
+  find_value(const value_type& __x) const
+  {
+    for (size_type __i = 0; __i < iSize; ++__i)
+    {
+      const_data_type __p = (*this)[__i];
+      if (__p && *__p == __x)
+        return begin() + __i;
+    }
+    return end();
+  }
+
+  template<typename _Pred>
+  const_iterator
+  find_if_value(_Pred __pred) const
+  {
+    for (size_type __i = 0; __i < iSize; ++__i)
+    {
+      const_data_type __p = (*this)[__i];
+      if (__p && __pred(*__p))
+        return begin() + __i;
+    }
+    return end();
+  }
+
+private:
+  struct _Header
+  {
+    char          magic[4];
+    std::uint32_t type_size;
+    std::uint32_t type_align;
+    std::uint32_t reserved;
+    std::uint64_t size;
+    std::uint64_t count;
+  };
+
+  // unmaps when the last shared_ptr into the file is gone
+  struct _Mapping
+  {
+    _Mapping(void* __p, std::size_t __n)
+    : addr(__p)
+    , length(__n)
+    { }
+
+    ~_Mapping()
+    { ::munmap(addr, length); }
+
+    _Mapping(const _Mapping&) = delete;
+    _Mapping& operator=(const _Mapping&) = delete;
+
+    void*       addr;
+    std::size_t length;
+  };
+
+  static constexpr char _S_magic[4] = { 'S', 'P', 'V', 'M' };
+
+  static std::size_t
+  _S_data_offset(std::size_t __size)
+  {
+    const std::size_t __o = sizeof(_Header) + __size * sizeof(std::uint64_t);
+    return (__o + alignof(_Tp) - 1) / alignof(_Tp) * alignof(_Tp);
+  }
+
+  const _Header&
+  _M_header() const
+  { return *static_cast<const _Header*>(iMap->addr); }
+
+  void
+  _M_check()
+  {
+    const _Header& __h = _M_header();
+    const char* __base = static_cast<const char*>(iMap->addr);
+    if (std::memcmp(__h.magic, _S_magic, sizeof(__h.magic)) != 0)
+      throw std::runtime_error("mapped_shared_ptr_vector: bad header");
+    if (__h.type_size != sizeof(_Tp) || __h.type_align != alignof(_Tp))
+      throw std::runtime_error("mapped_shared_ptr_vector: element type differs");
+    const std::size_t __max = iMap->length / sizeof(std::uint64_t);
+    if (__h.size > __max || __h.count > iMap->length / sizeof(_Tp)
+        || _S_data_offset(__h.size) + __h.count * sizeof(_Tp) > iMap->length)
+      throw std::runtime_error("mapped_shared_ptr_vector: file too short");
+    const std::uint64_t* __slots = reinterpret_cast<const std::uint64_t*>(__base + sizeof(_Header));
+    for (std::uint64_t __i = 0; __i < __h.size; ++__i)
+      if (__slots[__i] > __h.count)
+        throw std::runtime_error("mapped_shared_ptr_vector: bad reference");
+    iSlots = __slots;
+    iData = reinterpret_cast<const _Tp*>(__base + _S_data_offset(__h.size));
+    iSize = size_type(__h.size);
+  }
+
+  std::shared_ptr<_Mapping> iMap;
+  const std::uint64_t*      iSlots;
+  const _Tp*                iData;
+  size_type                 iSize;
+};
+
+#endif /* _mapped_shared_ptr_vector_h_ */
@@ -0,0 +1,455 @@
+#ifndef _sharded_shared_ptr_vector_h_
+#define _sharded_shared_ptr_vector_h_
+
+/**
+ * sharded_shared_ptr_vector is a shared_ptr_vector split in locked shards
+ * author : dhan71@naver.com
+ */
+/**
+*  @brief  A set of shared_ptr_vector shards, each with its own
+*  reader/writer lock, for many threads which find and modify at once.
+*
+*  @tparam _Tp  Type of element.
+*  @tparam _Shards  Number of shards.
+*  @tparam _Policy  Ownership policy (see shared_ptr_policy).
+*
+*  push_back(), emplace_back(), find_value() and erase_value() route a
+*  value to the shard std::hash<_Tp> picks, and lock that shard only.
+*  at() addresses the elements by index over the shards in order: shard 0
+*  first, then shard 1, and so on.  read() and write() run a function on
+*  one shard under its shared or exclusive lock.
+*
+*  for_each(), find_value() and sort() taking a shared_ptr_vector_parallel
+*  work on the shards in parallel.  After sort(), sorted() gives the
+*  elements in order through a k-way merge of the shards, without copying
+*  them.
+*
+*  Each shard sits on its own cache lines, so that threads which lock
+*  different shards do not contend on the same line.
+*
+*  @Note Positions move as other threads write.  A thread which holds a
+*        sorted() view must not write to the container.
+*/
+
+#include <shared_ptr_vector.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+template<typename _Tp, std::size_t _Shards = 16, typename _Policy = typename default_ptr_policy<_Tp>::type>
+class sharded_shared_ptr_vector
+{
+  static_assert(_Shards > 0, "_Shards must not be 0");
+
+public:
+  typedef typename _Policy::pointer shared_data_type;
+  typedef shared_ptr_vector<_Tp, std::allocator<shared_data_type>, _Policy> shard_type;
+
+  typedef _Tp                  value_type;
+  typedef _Tp*                 data_type;
+  typedef std::size_t          size_type;
+  typedef std::ptrdiff_t       difference_type;
+  typedef typename shard_type::shared_ptr_value_less shared_ptr_value_less;
+
+  static constexpr size_type shard_count = _Shards;
+
+  class sorted_view;
+
+public:
+  /**
+   *  @brief  Creates a sharded_shared_ptr_vector with no elements.
+   */
+  sharded_shared_ptr_vector()
+  { }
+
+  sharded_shared_ptr_vector(const sharded_shared_ptr_vector&) = delete;
+  sharded_shared_ptr_vector& operator=(const sharded_shared_ptr_vector&) = delete;
+
+public:
+  // routing by hash
+  /**
+   *  @brief  Returns the shard of a value.
+   *  @param  __x  A value.
+   */
+  static size_type
+  shard_of(const value_type& __x)
+  { return std::hash<_Tp>()(__x) % _Shards; }
+
+  /**
+   *  @brief  Add data to the shard of its value.
+   *  @param  __x  Data to be added, owned afterwards.  NULL goes to shard 0.
+   *  @return  The shard of the data.
+   */
+  size_type
+  push_back(const data_type& __x)
+  { return _M_add(shared_data_type(__x)); }
+
+  /**
+   *  @brief  Add a copy of a value to its shard.
+   *  @param  __x  Value to be copied.
+   *  @return  The shard of the copy.
+   */
+  size_type
+  push_back(const value_type& __x)
+  { return _M_add(_Policy::make(__x)); }
+
+  /**
+   *  @brief  Constructs an object and adds it to its shard.
+   *  @param  __args  Arguments forwarded to the constructor of _Tp.
+   *  @return  The shard of the object.
+   *
+   *  The object is constructed before any lock is taken.
+   */
+  template<typename... _Args>
+  size_type
+  emplace_back(_Args&&... __args)
+  { return _M_add(_Policy::make(std::forward<_Args>(__args)...)); }
+
+  /**
+   *  @brief  Finds an element equal to a value in the shard of the value.
+   *  @param  __x  A value.
+   *  @return  The element, or NULL.
+   */
+  shared_data_type
+  find_value(const value_type& __x) const
+  {
+    const _Shard& __s = iShards[shard_of(__x)];
+    std::shared_lock<std::shared_mutex> __l(__s.lock);
+    auto __i = __s.list.find_value(__x);
+    return __i != __s.list.end() ? *__i : shared_data_type();
+  }
+
+  /**
+   *  @brief  Erases the first element equal to a value from the shard of
+   *          the value.
+   *  @param  __x  A value.
+   *  @return  true if an element was erased.
+   */
+  bool
+  erase_value(const value_type& __x)
+  {
+    _Shard& __s = iShards[shard_of(__x)];
+    std::unique_lock<std::shared_mutex> __l(__s.lock);
+    auto __i = __s.list.find_value(__x);
+    if (__i == __s.list.end())
+      return false;
+    __s.list.erase(__i);
+    return true;
+  }
+
+public:
+  // routing by index
+  /**  Returns the number of elements of all the shards.  */
+  size_type
+  size() const
+  {
+    size_type __n = 0;
+    for (const _Shard& __s : iShards)
+    {
+      std::shared_lock<std::shared_mutex> __l(__s.lock);
+      __n += __s.list.size();
+    }
+    return __n;
+  }
+
+  bool
+  empty() const
+  { return size() == 0; }
+
+  /**
+   *  @brief  Provides access to an element by its index over the shards.
+   *  @param  __n  The index of the element.
+   *  @return  The element.
+   *  @throw  std::out_of_range  If @a __n is not less than size().
+   */
+  shared_data_type
+  at(size_type __n) const
+  {
+    for (const _Shard& __s : iShards)
+    {
+      std::shared_lock<std::shared_mutex> __l(__s.lock);
+      if (__n < __s.list.size())
+        return __s.list.begin()[__n];
+      __n -= __s.list.size();
+    }
+    throw std::out_of_range("sharded_shared_ptr_vector::at");
+  }
+
+  /**
+   *  @brief  Runs a function on a shard under its shared lock.
+   *  @param  __k  The shard.
+   *  @param  __f  Function called with a const shard_type&.
+   *  @return  What @a __f returns.
+   */
+  template<typename _Fn>
+  auto
+  read(size_type __k, _Fn __f) const
+  {
+    std::shared_lock<std::shared_mutex> __l(iShards[__k].lock);
+    return __f(static_cast<const shard_type&>(iShards[__k].list));
+  }
+
+  /**
+   *  @brief  Runs a function on a shard under its exclusive lock.
+   *  @param  __k  The shard.
+   *  @param  __f  Function called with a shard_type&.
+   *  @return  What @a __f returns.
+   */
+  template<typename _Fn>
+  auto
+  write(size_type __k, _Fn __f)
+  {
+    std::unique_lock<std::shared_mutex> __l(iShards[__k].lock);
+    return __f(iShards[__k].list);
+  }
+
+  /**
+   *  Erases all the elements, one shard at a time.
+   */
+  void
+  clear()
+  {
+    for (_Shard& __s : iShards)
+    {
+      std::unique_lock<std::shared_mutex> __l(__s.lock);
+      __s.list.clear();
+    }
+  }
+
+public:
+  // parallel
+  /**
+   *  @brief  Calls a function on every slot, the shards in parallel.
+   *  @param  __par  The threads to use.
+   *  @param  __f  Function called with a const shared_data_type&, from
+   *               several threads at once.
+   *
+   *  Each shard is read under its shared lock.
+   */
+  template<typename _Fn>
+  void
+  for_each(const shared_ptr_vector_parallel& __par, _Fn __f) const
+  {
+    _M_run(__par, [this, &__f](size_type __k)
+                  {
+                    const _Shard& __s = iShards[__k];
+                    std::shared_lock<std::shared_mutex> __l(__s.lock);
+                    for (auto __i = __s.list.begin(); __i != __s.list.end(); ++__i)
+                      __f(*__i);
+                  });
+  }
+
+  /**
+   *  @brief  Finds an element equal to a value in all the shards, in
+   *          parallel.
+   *  @param  __par  The threads to use.
+   *  @param  __x  A value.
+   *  @return  The first element found in shard order, or NULL.
+   *
+   *  Use this for elements put in other shards than their own by write().
+   */
+  shared_data_type
+  find_value(const shared_ptr_vector_parallel& __par, const value_type& __x) const
+  {
+    std::vector<shared_data_type> __found(_Shards);
+    _M_run(__par, [this, &__x, &__found](size_type __k)
+                  {
+                    const _Shard& __s = iShards[__k];
+                    std::shared_lock<std::shared_mutex> __l(__s.lock);
+                    auto __i = __s.list.find_value(__x);
+                    if (__i != __s.list.end())
+                      __found[__k] = *__i;
+                  });
+    for (auto __i = __found.begin(); __i != __found.end(); ++__i)
+      if (*__i)
+        return *__i;
+    return shared_data_type();
+  }
+
+  /**
+   *  @brief  Sorts every shard, the shards in parallel.
+   *  @param  __par  The threads to use.
+   *
+   *  Each shard is a std::stable_sort with shared_ptr_value_less under its
+   *  exclusive lock.  Use sorted() to read all the elements in order.
+   */
+  void
+  sort(const shared_ptr_vector_parallel& __par)
+  {
+    _M_run(__par, [this](size_type __k)
+                  {
+                    _Shard& __s = iShards[__k];
+                    std::unique_lock<std::shared_mutex> __l(__s.lock);
+                    __s.list.sort(shared_ptr_vector_parallel(1));
+                  });
+  }
+
+  /**
+   *  @brief  Merges the sorted shards.
+   *  @return  A view of all the elements in order, which holds the shared
+   *           locks of the shards until it is destroyed.
+   *
+   *  The shards must be sorted (see sort()).  Equal elements come in shard
+   *  order.
+   */
+  sorted_view
+  sorted() const
+  { return sorted_view(*this); }
+
+private:
+  // one shard per cache line at least, so the locks do not share lines
+  struct alignas(64) _Shard
+  {
+    mutable std::shared_mutex lock;
+    shard_type                list;
+  };
+
+  size_type
+  _M_add(shared_data_type&& __p)
+  {
+    const size_type __k = __p ? shard_of(*__p) : 0;
+    _Shard& __s = iShards[__k];
+    std::unique_lock<std::shared_mutex> __l(__s.lock);
+    __s.list.push_back(std::move(__p));
+    return __k;
+  }
+
+  // runs __f(shard) for every shard, spread over the threads of __par
+  template<typename _Fn>
+  static void
+  _M_run(const shared_ptr_vector_parallel& __par, _Fn __f)
+  {
+    const unsigned __t = std::min<size_type>(__par.threads, _Shards);
+    shared_ptr_vector_parallel::run(__t, [__t, &__f](unsigned __i)
+                                    {
+                                      for (size_type __k = __i; __k < _Shards; __k += __t)
+                                        __f(__k);
+                                    });
+  }
+
+  _Shard iShards[_Shards];
+};
+
+/**
+*  @brief  The elements of a sharded_shared_ptr_vector in order, merged
+*  from its sorted shards while they are iterated.
+*/
+template<typename _Tp, std::size_t _Shards, typename _Policy>
+class sharded_shared_ptr_vector<_Tp, _Shards, _Policy>::sorted_view
+{
+  typedef typename shard_type::const_iterator _Iter;
+
+  struct _Run
+  {
+    _Iter     cur;
+    _Iter     end;
+    size_type shard;
+  };
+
+public:
+  /**
+   *  A forward iterator which takes the least of the heads of the shards.
+   */
+  class const_iterator
+  {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef shared_data_type          value_type;
+    typedef std::ptrdiff_t            difference_type;
+    typedef const shared_data_type*   pointer;
+    typedef const shared_data_type&   reference;
+
+    const_iterator()
+    { }
+
+    reference operator*() const { return *iHeap.front().cur; }
+    pointer operator->() const { return &*iHeap.front().cur; }
+
+    const_iterator&
+    operator++()
+    {
+      std::pop_heap(iHeap.begin(), iHeap.end(), _S_after);
+      if (++iHeap.back().cur == iHeap.back().end)
+        iHeap.pop_back();
+      else
+        std::push_heap(iHeap.begin(), iHeap.end(), _S_after);
+      return *this;
+    }
+
+    const_iterator
+    operator++(int)
+    {
+      const_iterator __r(*this);
+      ++*this;
+      return __r;
+    }
+
+    bool
+    operator==(const const_iterator& __x) const
+    {
+      if (iHeap.empty() || __x.iHeap.empty())
+        return iHeap.empty() == __x.iHeap.empty();
+      return iHeap.front().cur == __x.iHeap.front().cur;
+    }
+
+    bool
+    operator!=(const const_iterator& __x) const
+    { return !(*this == __x); }
+
+  private:
+    friend class sorted_view;
+
+    // heap order: the least head on top, the lower shard first on ties
+    static bool
+    _S_after(const _Run& __a, const _Run& __b)
+    {
+      if (shared_ptr_value_less()(*__b.cur, *__a.cur))
+        return true;
+      if (shared_ptr_value_less()(*__a.cur, *__b.cur))
+        return false;
+      return __b.shard < __a.shard;
+    }
+
+    std::vector<_Run> iHeap;
+  };
+
+  explicit
+  sorted_view(const sharded_shared_ptr_vector& __x)
+  {
+    iLocks.reserve(_Shards);
+    for (size_type __k = 0; __k < _Shards; ++__k)
+    {
+      const shard_type& __s = __x.iShards[__k].list;
+      iLocks.emplace_back(__x.iShards[__k].lock);
+      if (!__s.empty())
+        iBegin.iHeap.push_back(_Run{ __s.begin(), __s.end(), __k });
+      iSize += __s.size();
+    }
+    std::make_heap(iBegin.iHeap.begin(), iBegin.iHeap.end(), const_iterator::_S_after);
+  }
+
+  const_iterator
+  begin() const
+  { return iBegin; }
+
+  const_iterator
+  end() const
+  { return const_iterator(); }
+
+  size_type
+  size() const
+  { return iSize; }
+
+private:
+  std::vector<std::shared_lock<std::shared_mutex> > iLocks;
+  const_iterator                                    iBegin;
+  size_type                                         iSize = 0;
+};
+
+#endif /* _sharded_shared_ptr_vector_h_ */
@@ -0,0 +1,309 @@
+#ifndef _shared_ptr_reclaimer_h_
+#define _shared_ptr_reclaimer_h_
+
+/**
+ * shared_ptr_reclaimer destroys released elements later or elsewhere
+ * author : dhan71@naver.com
+ */
+/**
+*  @brief  A queue of released slots whose destruction is deferred.
+*
+*  A shared_ptr_vector given a reclaimer (see
+*  shared_ptr_vector::set_reclaimer()) does not destroy the slots it lets
+*  go in clear(), erase(), pop_back() and its destructor: it moves them to
+*  the reclaimer, in O(1) per call for clear() and the destructor and
+*  O(1) per slot otherwise.  The reference counts are dropped, and the
+*  elements destroyed, when the queue is drained by reclaim() or by the
+*  background thread of the reclaimer.
+*
+*  The queue is intrusive: a container takes its queue entries from a
+*  shared_ptr_reclaimer_cache, to which the reclaimer gives them back
+*  once it has destroyed what they held, so that retiring does not
+*  allocate once the cache is warm.
+*
+*  retire() is lock-free and may be called from any thread.  One reclaimer
+*  may serve many containers, and must outlive them.
+*
+*  @Note Elements live until they are reclaimed.  Slots with a non-atomic
+*        count (local_ptr_policy) must be reclaimed by the thread which
+*        owns them, so do not start a background thread for them.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+class shared_ptr_reclaimer
+{
+public:
+  /**
+   *  @brief  Creates a reclaimer drained by reclaim() calls.
+   */
+  shared_ptr_reclaimer()
+  { }
+
+  /**
+   *  @brief  Creates a reclaimer drained by a background thread.
+   *  @param  __interval  How long the thread sleeps when the queue is
+   *                      empty.
+   */
+  explicit
+  shared_ptr_reclaimer(std::chrono::microseconds __interval)
+  : iThread([this, __interval]
+            {
+              while (!iStop.load(std::memory_order_acquire))
+                if (reclaim() == 0)
+                  std::this_thread::sleep_for(__interval);
+            })
+  { }
+
+  /**
+   *  Stops the background thread, if any, and reclaims what is left.
+   */
+  ~shared_ptr_reclaimer()
+  {
+    iStop.store(true, std::memory_order_release);
+    if (iThread.joinable())
+      iThread.join();
+    while (reclaim())
+      ;
+  }
+
+  shared_ptr_reclaimer(const shared_ptr_reclaimer&) = delete;
+  shared_ptr_reclaimer& operator=(const shared_ptr_reclaimer&) = delete;
+
+  /**
+   *  An entry of the queue.  reclaim() destroys what the entry holds and
+   *  frees or reuses the entry.
+   */
+  struct node
+  {
+    node* next = nullptr;
+
+    virtual void reclaim() noexcept = 0;
+
+  protected:
+    ~node() { }
+  };
+
+  /**
+   *  @brief  Queues an entry, without allocating.
+   *  @param  __n  An entry, which belongs to the reclaimer until its
+   *               reclaim() is called.
+   */
+  void
+  retire(node* __n) noexcept
+  {
+    iPending.fetch_add(1, std::memory_order_relaxed);
+    __n->next = iHead.load(std::memory_order_relaxed);
+    while (!iHead.compare_exchange_weak(__n->next, __n, std::memory_order_release, std::memory_order_relaxed))
+      ;
+  }
+
+  /**
+   *  @brief  Queues an object for destruction.
+   *  @param  __x  A slot, or a container of slots, moved into the queue.
+   *
+   *  This allocates an entry; see shared_ptr_reclaimer_cache to reuse
+   *  them.
+   */
+  template<typename _Up>
+  void
+  retire(_Up&& __x)
+  {
+    static_assert(!std::is_lvalue_reference<_Up>::value, "retire takes an rvalue");
+    retire(static_cast<node*>(new _Node_of<_Up>(std::move(__x))));
+  }
+
+  /**
+   *  @brief  Queues an object for destruction, if an entry can be had.
+   *  @return  false, and @a __x untouched, if the entry could not be
+   *           allocated.
+   */
+  template<typename _Up>
+  bool
+  retire(const std::nothrow_t&, _Up&& __x) noexcept
+  {
+    static_assert(!std::is_lvalue_reference<_Up>::value, "retire takes an rvalue");
+    static_assert(std::is_nothrow_move_constructible<_Up>::value, "_Up must move without throwing");
+    node* __n = new (std::nothrow) _Node_of<_Up>(std::move(__x));
+    if (!__n)
+      return false;
+    retire(__n);
+    return true;
+  }
+
+  /**
+   *  @brief  Destroys the queued objects on the calling thread.
+   *  @return  Number of objects destroyed.
+   *
+   *  Objects queued while this runs are left for the next call.
+   */
+  std::size_t
+  reclaim()
+  {
+    node* __n = iHead.exchange(nullptr, std::memory_order_acquire);
+    std::size_t __k = 0;
+    while (__n)
+    {
+      node* __next = __n->next;
+      __n->reclaim();
+      __n = __next;
+      ++__k;
+    }
+    if (__k)
+      iPending.fetch_sub(__k, std::memory_order_relaxed);
+    return __k;
+  }
+
+  /**  Returns the number of objects waiting for destruction.  */
+  std::size_t
+  pending() const
+  { return iPending.load(std::memory_order_relaxed); }
+
+private:
+  template<typename _Up>
+  struct _Node_of final : node
+  {
+    explicit
+    _Node_of(_Up&& __x)
+    : iObj(std::move(__x))
+    { }
+
+    void
+    reclaim() noexcept override
+    { delete this; }
+
+    _Up iObj;
+  };
+
+  std::atomic<node*>       iHead{nullptr};
+  std::atomic<std::size_t> iPending{0};
+  std::atomic<bool>        iStop{false};
+  std::thread              iThread;
+};
+
+/**
+ *  @brief  Reusable queue entries for objects of type _Up.
+ *
+ *  The owner (a container) takes entries with retire(), from any thread
+ *  that owns the container; the reclaimer gives them back from the thread
+ *  that reclaims.  Like shared_ptr_pool, the cache deletes itself once
+ *  the owner has released it and the last entry is back.
+ */
+template<typename _Up>
+class shared_ptr_reclaimer_cache
+{
+public:
+  shared_ptr_reclaimer_cache()
+  : iRefs(1)
+  , iRemote(nullptr)
+  , iFree(nullptr)
+  { }
+
+  shared_ptr_reclaimer_cache(const shared_ptr_reclaimer_cache&) = delete;
+  shared_ptr_reclaimer_cache& operator=(const shared_ptr_reclaimer_cache&) = delete;
+
+  /**  Allocates @a __n entries ahead.  */
+  void
+  reserve(std::size_t __n)
+  {
+    for (std::size_t __i = 0; __i < __n; ++__i)
+    {
+      _Entry* __e = new _Entry(this);
+      __e->next = iFree;
+      iFree = __e;
+    }
+  }
+
+  /**
+   *  @brief  Queues @a __x on @a __r in an entry of the cache.
+   *  @return  false, and @a __x untouched, if no entry could be had.
+   */
+  bool
+  retire(shared_ptr_reclaimer& __r, _Up&& __x) noexcept
+  {
+    _Entry* __e = iFree;
+    if (!__e)
+      __e = iRemote.exchange(nullptr, std::memory_order_acquire);
+    if (__e)
+      iFree = static_cast<_Entry*>(__e->next);
+    else if (!(__e = new (std::nothrow) _Entry(this)))
+      return false;
+    __e->obj = std::move(__x);
+    iRefs.fetch_add(1, std::memory_order_relaxed);
+    __r.retire(static_cast<shared_ptr_reclaimer::node*>(__e));
+    return true;
+  }
+
+  /**
+   *  The owner gives up the cache.  It is deleted when the last entry is
+   *  back.
+   */
+  void
+  release()
+  { _M_unref(); }
+
+private:
+  struct _Entry final : shared_ptr_reclaimer::node
+  {
+    explicit
+    _Entry(shared_ptr_reclaimer_cache* __c)
+    : home(__c)
+    { }
+
+    void
+    reclaim() noexcept override
+    {
+      { _Up __x(std::move(obj)); }
+      home->_M_put(this);
+    }
+
+    _Up                         obj;
+    shared_ptr_reclaimer_cache* home;
+  };
+
+  ~shared_ptr_reclaimer_cache()
+  {
+    _S_free(iFree);
+    _S_free(iRemote.load(std::memory_order_acquire));
+  }
+
+  static void
+  _S_free(_Entry* __e)
+  {
+    while (__e)
+    {
+      _Entry* __next = static_cast<_Entry*>(__e->next);
+      delete __e;
+      __e = __next;
+    }
+  }
+
+  void
+  _M_put(_Entry* __e) noexcept
+  {
+    _Entry* __head = iRemote.load(std::memory_order_relaxed);
+    do
+      __e->next = __head;
+    while (!iRemote.compare_exchange_weak(__head, __e, std::memory_order_release, std::memory_order_relaxed));
+    _M_unref();
+  }
+
+  void
+  _M_unref()
+  {
+    if (iRefs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete this;
+  }
+
+  std::atomic<std::size_t> iRefs;   // the owner + queued entries
+  std::atomic<_Entry*>     iRemote; // entries given back, from any thread
+  _Entry*                  iFree;   // owner side free list
+};
+
+#endif /* _shared_ptr_reclaimer_h_ */
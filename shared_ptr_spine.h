@@ -0,0 +1,541 @@
+#ifndef _shared_ptr_spine_h_
+#define _shared_ptr_spine_h_
+
+/**
+ * shared_ptr_spine is the slot array of shared_ptr_vector
+ * author : dhan71@naver.com
+ */
+/**
+*  @brief  A vector of reference counted pointers which relocates them
+*  bitwise.
+*
+*  @tparam _Tp  Type of slot (std::shared_ptr, local_shared_ptr or
+*               intrusive_shared_ptr).
+*  @tparam _Alloc  Allocator type of the slots.
+*
+*  It offers the part of std::vector which shared_ptr_vector uses, with
+*  pointers as iterators.  A smart pointer does not refer to its own
+*  address, so when the buffer grows, and when the slots after an insert
+*  or an erase move, they are copied with memcpy/memmove instead of being
+*  move constructed and destroyed one by one.
+*
+*  The buffer is taken from std::malloc and grown by std::realloc, which
+*  for large buffers remaps the pages instead of copying them.  So only
+*  std::allocator, whose memory is interchangeable, may be given (see
+*  shared_ptr_spine_relocatable).  The copy and the move of a slot must
+*  not throw.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+template<typename _Tp> class local_shared_ptr;
+template<typename _Tp> class intrusive_shared_ptr;
+
+/**
+ *  True if slots of type _Tp may be moved by memcpy.
+ */
+template<typename _Tp>
+struct is_trivially_relocatable
+: std::is_trivially_copyable<_Tp>
+{ };
+
+template<typename _Tp>
+struct is_trivially_relocatable<std::shared_ptr<_Tp> >
+: std::true_type
+{ };
+
+template<typename _Tp>
+struct is_trivially_relocatable<local_shared_ptr<_Tp> >
+: std::true_type
+{ };
+
+template<typename _Tp>
+struct is_trivially_relocatable<intrusive_shared_ptr<_Tp> >
+: std::true_type
+{ };
+
+/**
+ *  True if shared_ptr_spine<_Tp, _Alloc> may be used.  Other allocators may
+ *  construct, destroy or point in ways a memcpy would skip, so
+ *  shared_ptr_vector keeps std::vector for them.
+ */
+template<typename _Tp, typename _Alloc>
+struct shared_ptr_spine_relocatable
+: std::integral_constant<bool, is_trivially_relocatable<_Tp>::value
+                               && std::is_same<_Alloc, std::allocator<_Tp> >::value>
+{ };
+
+template<typename _Tp, typename _Alloc = std::allocator<_Tp> >
+class shared_ptr_spine
+{
+  typedef std::allocator_traits<_Alloc> _Alloc_traits;
+
+public:
+  typedef _Tp                                   value_type;
+  typedef _Tp*                                  pointer;
+  typedef const _Tp*                            const_pointer;
+  typedef _Tp&                                  reference;
+  typedef const _Tp&                            const_reference;
+  typedef _Tp*                                  iterator;
+  typedef const _Tp*                            const_iterator;
+  typedef std::reverse_iterator<iterator>       reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+  typedef std::size_t                           size_type;
+  typedef std::ptrdiff_t                        difference_type;
+  typedef _Alloc                                allocator_type;
+
+public:
+  shared_ptr_spine() noexcept
+  { }
+
+  explicit
+  shared_ptr_spine(const allocator_type& __a) noexcept
+  : iAlloc(__a)
+  { }
+
+  explicit
+  shared_ptr_spine(size_type __n, const allocator_type& __a = allocator_type())
+  : iAlloc(__a)
+  {
+    _M_reserve_exact(__n);
+    for ( ; iEnd != iBegin + __n; ++iEnd)
+      ::new (static_cast<void*>(iEnd)) _Tp();
+  }
+
+  shared_ptr_spine(size_type __n, const value_type& __x, const allocator_type& __a = allocator_type())
+  : iAlloc(__a)
+  {
+    _M_reserve_exact(__n);
+    for ( ; iEnd != iBegin + __n; ++iEnd)
+      ::new (static_cast<void*>(iEnd)) _Tp(__x);
+  }
+
+  shared_ptr_spine(const shared_ptr_spine& __x)
+  : iAlloc(_Alloc_traits::select_on_container_copy_construction(__x.iAlloc))
+  {
+    _M_copy_from(__x);
+  }
+
+  shared_ptr_spine(const shared_ptr_spine& __x, const allocator_type& __a)
+  : iAlloc(__a)
+  {
+    _M_copy_from(__x);
+  }
+
+  shared_ptr_spine(shared_ptr_spine&& __x) noexcept
+  : iAlloc(std::move(__x.iAlloc))
+  {
+    _M_steal(__x);
+  }
+
+  shared_ptr_spine(shared_ptr_spine&& __x, const allocator_type& __a)
+  : iAlloc(__a)
+  {
+    // the buffer does not come from the allocator
+    _M_steal(__x);
+  }
+
+  ~shared_ptr_spine()
+  {
+    _M_destroy(iBegin, iEnd);
+    _M_deallocate();
+  }
+
+  shared_ptr_spine&
+  operator=(const shared_ptr_spine& __x)
+  {
+    if (&__x != this)
+    {
+      clear();
+      reserve(__x.size());
+      for (const_iterator __i = __x.iBegin; __i != __x.iEnd; ++__i, ++iEnd)
+        ::new (static_cast<void*>(iEnd)) _Tp(*__i);
+    }
+    return *this;
+  }
+
+  shared_ptr_spine&
+  operator=(shared_ptr_spine&& __x) noexcept
+  {
+    if (&__x != this)
+    {
+      shared_ptr_spine __tmp(std::move(*this));
+      iAlloc = std::move(__x.iAlloc);
+      _M_steal(__x);
+    }
+    return *this;
+  }
+
+  void
+  assign(size_type __n, const value_type& __x)
+  {
+    value_type __v(__x);
+    clear();
+    reserve(__n);
+    for ( ; iEnd != iBegin + __n; ++iEnd)
+      ::new (static_cast<void*>(iEnd)) _Tp(__v);
+  }
+
+  template<typename _InputIterator>
+  void
+  assign(_InputIterator __first, _InputIterator __last)
+  {
+    clear();
+    for ( ; __first != __last; ++__first)
+      push_back(*__first);
+  }
+
+  allocator_type
+  get_allocator() const noexcept
+  { return iAlloc; }
+
+public:
+  // iterators
+  iterator       begin() noexcept        { return iBegin; }
+  const_iterator begin() const noexcept  { return iBegin; }
+  iterator       end() noexcept          { return iEnd; }
+  const_iterator end() const noexcept    { return iEnd; }
+  const_iterator cbegin() const noexcept { return iBegin; }
+  const_iterator cend() const noexcept   { return iEnd; }
+
+  reverse_iterator       rbegin() noexcept        { return reverse_iterator(iEnd); }
+  const_reverse_iterator rbegin() const noexcept  { return const_reverse_iterator(iEnd); }
+  reverse_iterator       rend() noexcept          { return reverse_iterator(iBegin); }
+  const_reverse_iterator rend() const noexcept    { return const_reverse_iterator(iBegin); }
+  const_reverse_iterator crbegin() const noexcept { return const_reverse_iterator(iEnd); }
+  const_reverse_iterator crend() const noexcept   { return const_reverse_iterator(iBegin); }
+
+  // capacity
+  size_type
+  size() const noexcept
+  { return iEnd - iBegin; }
+
+  size_type
+  max_size() const noexcept
+  { return std::min<size_type>(_Alloc_traits::max_size(iAlloc), std::numeric_limits<difference_type>::max() / sizeof(_Tp)); }
+
+  size_type
+  capacity() const noexcept
+  { return iCap - iBegin; }
+
+  bool
+  empty() const noexcept
+  { return iBegin == iEnd; }
+
+  void
+  reserve(size_type __n)
+  {
+    if (__n > max_size())
+      throw std::length_error("shared_ptr_spine::reserve");
+    if (__n > capacity())
+      _M_reallocate(__n);
+  }
+
+  void
+  shrink_to_fit()
+  {
+    if (iCap != iEnd)
+      _M_reallocate(size());
+  }
+
+  void
+  resize(size_type __n)
+  {
+    if (__n < size())
+      _M_erase_at_end(iBegin + __n);
+    else
+    {
+      _M_reserve_for(__n - size());
+      for (pointer __e = iBegin + __n; iEnd != __e; ++iEnd)
+        ::new (static_cast<void*>(iEnd)) _Tp();
+    }
+  }
+
+  void
+  resize(size_type __n, const value_type& __x)
+  {
+    if (__n < size())
+      _M_erase_at_end(iBegin + __n);
+    else
+    {
+      value_type __v(__x);
+      _M_reserve_for(__n - size());
+      for (pointer __e = iBegin + __n; iEnd != __e; ++iEnd)
+        ::new (static_cast<void*>(iEnd)) _Tp(__v);
+    }
+  }
+
+  // element access
+  reference       operator[](size_type __n) noexcept       { return iBegin[__n]; }
+  const_reference operator[](size_type __n) const noexcept { return iBegin[__n]; }
+
+  reference
+  at(size_type __n)
+  {
+    if (__n >= size())
+      throw std::out_of_range("shared_ptr_spine::at");
+    return iBegin[__n];
+  }
+
+  const_reference
+  at(size_type __n) const
+  {
+    if (__n >= size())
+      throw std::out_of_range("shared_ptr_spine::at");
+    return iBegin[__n];
+  }
+
+  reference       front() noexcept       { return *iBegin; }
+  const_reference front() const noexcept { return *iBegin; }
+  reference       back() noexcept        { return *(iEnd - 1); }
+  const_reference back() const noexcept  { return *(iEnd - 1); }
+
+  pointer       data() noexcept       { return iBegin; }
+  const_pointer data() const noexcept { return iBegin; }
+
+public:
+  // modifiers
+  void
+  push_back(const value_type& __x)
+  {
+    if (iEnd == iCap)
+    {
+      // __x may be a slot of this spine
+      value_type __v(__x);
+      _M_reallocate(_M_grow(1));
+      ::new (static_cast<void*>(iEnd)) _Tp(std::move(__v));
+    }
+    else
+      ::new (static_cast<void*>(iEnd)) _Tp(__x);
+    ++iEnd;
+  }
+
+  void
+  push_back(value_type&& __x)
+  {
+    if (iEnd == iCap)
+    {
+      value_type __v(std::move(__x));
+      _M_reallocate(_M_grow(1));
+      ::new (static_cast<void*>(iEnd)) _Tp(std::move(__v));
+    }
+    else
+      ::new (static_cast<void*>(iEnd)) _Tp(std::move(__x));
+    ++iEnd;
+  }
+
+  template<typename... _Args>
+  reference
+  emplace_back(_Args&&... __args)
+  {
+    push_back(value_type(std::forward<_Args>(__args)...));
+    return back();
+  }
+
+  void
+  pop_back() noexcept
+  {
+    --iEnd;
+    iEnd->~_Tp();
+  }
+
+  iterator
+  insert(const_iterator __position, const value_type& __x)
+  {
+    return insert(__position, value_type(__x));
+  }
+
+  iterator
+  insert(const_iterator __position, value_type&& __x)
+  {
+    value_type __v(std::move(__x));
+    pointer __p = _M_open(__position, 1);
+    ::new (static_cast<void*>(__p)) _Tp(std::move(__v));
+    return __p;
+  }
+
+  iterator
+  insert(const_iterator __position, size_type __n, const value_type& __x)
+  {
+    value_type __v(__x);
+    pointer __p = _M_open(__position, __n);
+    for (pointer __i = __p; __i != __p + __n; ++__i)
+      ::new (static_cast<void*>(__i)) _Tp(__v);
+    return __p;
+  }
+
+  iterator
+  erase(const_iterator __position)
+  {
+    // as with the std::vector of libstdc++, erase(end()) drops the last slot
+    if (__position == iEnd)
+    {
+      pointer __p = iEnd;
+      pop_back();
+      return __p;
+    }
+    return erase(__position, __position + 1);
+  }
+
+  iterator
+  erase(const_iterator __first, const_iterator __last)
+  {
+    pointer __f = iBegin + (__first - iBegin);
+    pointer __l = iBegin + (__last - iBegin);
+    if (__f != __l)
+    {
+      _M_destroy(__f, __l);
+      std::memmove(static_cast<void*>(__f), static_cast<const void*>(__l), (iEnd - __l) * sizeof(_Tp));
+      iEnd -= __l - __f;
+    }
+    return __f;
+  }
+
+  void
+  clear() noexcept
+  { _M_erase_at_end(iBegin); }
+
+  void
+  swap(shared_ptr_spine& __x) noexcept
+  {
+    std::swap(iBegin, __x.iBegin);
+    std::swap(iEnd, __x.iEnd);
+    std::swap(iCap, __x.iCap);
+    if (_Alloc_traits::propagate_on_container_swap::value)
+      std::swap(iAlloc, __x.iAlloc);
+  }
+
+  /**
+   *  @brief  Frees the buffer without destroying the slots.
+   *
+   *  For slots whose pointees and reference counts are freed some other
+   *  way (see shared_ptr_vector::release_all()).
+   */
+  void
+  forget() noexcept
+  {
+    iEnd = iBegin;
+    _M_deallocate();
+  }
+
+private:
+  // makes room for __n more slots, growing the buffer geometrically
+  void
+  _M_reserve_for(size_type __n)
+  {
+    if (size_type(iCap - iEnd) < __n)
+      _M_reallocate(_M_grow(__n));
+  }
+
+  size_type
+  _M_grow(size_type __n) const
+  {
+    if (max_size() - size() < __n)
+      throw std::length_error("shared_ptr_spine::_M_grow");
+    const size_type __len = size() + std::max(size(), __n);
+    return (__len < size() || __len > max_size()) ? max_size() : __len;
+  }
+
+  // moves the slots to a buffer of __n (__n >= size()), bitwise
+  void
+  _M_reallocate(size_type __n)
+  {
+    if (__n == 0)
+    {
+      _M_deallocate();
+      return;
+    }
+    void* __b = std::realloc(static_cast<void*>(iBegin), __n * sizeof(_Tp));
+    if (!__b)
+      throw std::bad_alloc();
+    const size_type __s = size();
+    iBegin = static_cast<pointer>(__b);
+    iEnd = iBegin + __s;
+    iCap = iBegin + __n;
+  }
+
+  void
+  _M_reserve_exact(size_type __n)
+  {
+    if (__n)
+    {
+      _M_reallocate(__n);
+      iEnd = iBegin;
+    }
+  }
+
+  // opens a gap of __n raw slots at __position, shifting the tail once
+  pointer
+  _M_open(const_iterator __position, size_type __n)
+  {
+    const size_type __off = __position - iBegin;
+    _M_reserve_for(__n);
+    std::memmove(static_cast<void*>(iBegin + __off + __n), static_cast<const void*>(iBegin + __off),
+                 (size() - __off) * sizeof(_Tp));
+    iEnd += __n;
+    return iBegin + __off;
+  }
+
+  static void
+  _M_relocate(const_pointer __first, const_pointer __last, pointer __to) noexcept
+  {
+    if (__first != __last)
+      std::memcpy(static_cast<void*>(__to), static_cast<const void*>(__first), (__last - __first) * sizeof(_Tp));
+  }
+
+  static void
+  _M_destroy(pointer __first, pointer __last) noexcept
+  {
+    for ( ; __first != __last; ++__first)
+      __first->~_Tp();
+  }
+
+  void
+  _M_erase_at_end(pointer __pos) noexcept
+  {
+    _M_destroy(__pos, iEnd);
+    iEnd = __pos;
+  }
+
+  void
+  _M_deallocate() noexcept
+  {
+    std::free(static_cast<void*>(iBegin));
+    iBegin = iEnd = iCap = pointer();
+  }
+
+  void
+  _M_steal(shared_ptr_spine& __x) noexcept
+  {
+    iBegin = __x.iBegin;
+    iEnd = __x.iEnd;
+    iCap = __x.iCap;
+    __x.iBegin = __x.iEnd = __x.iCap = pointer();
+  }
+
+  void
+  _M_copy_from(const shared_ptr_spine& __x)
+  {
+    _M_reserve_exact(__x.size());
+    for (const_iterator __i = __x.iBegin; __i != __x.iEnd; ++__i, ++iEnd)
+      ::new (static_cast<void*>(iEnd)) _Tp(*__i);
+  }
+
+  _Alloc  iAlloc;
+  pointer iBegin = pointer();
+  pointer iEnd = pointer();
+  pointer iCap = pointer();
+};
+
+#endif /* _shared_ptr_spine_h_ */
@@ -12,7 +12,11 @@
 *  @ingroup sequences
 *
 *  @tparam _Tp  Type of element.
-*  @tparam _Alloc  Allocator type, defaults to allocator<_Tp>.
+*  @tparam _Alloc  Allocator type, defaults to allocator<_Tp>.  It is
+*                  rebound to the slot type of @a _Policy.
+*  @tparam _Policy  Ownership policy which gives the slot type
+*                   (shared_data_type) and how elements are made,
+*                   defaults to default_ptr_policy<_Tp>::type.
 *
 *  Meets the requirements of a <a href="tables.html#65">container</a>, a
 *  <a href="tables.html#66">reversible container</a>, and a
@@ -31,21 +35,597 @@
 #include <memory>
 #include <initializer_list>
 #include <algorithm>
+#include <functional>
 #include <string>
 #include <sstream>
 #include <ostream>
 #include <iostream>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <stdexcept>
+#include <charconv>
+#include <limits>
+#include <local_shared_ptr.h>
+#ifdef SHARED_PTR_VECTOR_TRACE
+#include <shared_ptr_vector_trace.h>
+#endif
+#include <shared_ptr_vector_stats.h>
+#include <intrusive_shared_ptr.h>
+#include <shared_ptr_spine.h>
+#include <shared_ptr_reclaimer.h>
+
+/**
+ *  @brief  A fixed-size block pool for the elements of a shared_ptr_vector.
+ *
+ *  Blocks are carved from chunks of blocks_per_chunk() blocks.  The block
+ *  size is taken from the first allocation, which is the control block
+ *  the ownership policy builds around an element; requests of any other
+ *  size go to operator new.
+ *
+ *  Blocks are allocated only by the owning shared_ptr_vector but may be
+ *  freed from any thread, since the elements are shared.  The pool
+ *  deletes itself once the owner has released it and the last block is
+ *  freed.
+ */
+class shared_ptr_pool
+{
+public:
+  explicit
+  shared_ptr_pool(std::size_t __blocks_per_chunk)
+  : iRefs(1)
+  , iRemote(nullptr)
+  , iFree(nullptr)
+  , iChunks(nullptr)
+  , iCur(nullptr)
+  , iEnd(nullptr)
+  , iBlockSize(0)
+  , iBlocksPerChunk(__blocks_per_chunk ? __blocks_per_chunk : 1)
+  , iChunkCount(0)
+  { }
+
+  shared_ptr_pool(const shared_ptr_pool&) = delete;
+  shared_ptr_pool& operator=(const shared_ptr_pool&) = delete;
+
+  void*
+  allocate(std::size_t __bytes, std::size_t __align)
+  {
+    if (iBlockSize == 0 && __align <= alignof(std::max_align_t))
+      iBlockSize = _S_round(__bytes < sizeof(_Block) ? sizeof(_Block) : __bytes);
+    if (!_M_pooled(__bytes, __align))
+      return ::operator new(__bytes);
+
+    _Block* __b = iFree;
+    if (!__b)
+      __b = iRemote.exchange(nullptr, std::memory_order_acquire);
+    if (__b)
+      iFree = __b->next;
+    else
+    {
+      if (iCur == iEnd)
+        _M_new_chunk();
+      __b = reinterpret_cast<_Block*>(iCur);
+      iCur += iBlockSize;
+    }
+    iRefs.fetch_add(1, std::memory_order_relaxed);
+    return __b;
+  }
+
+  void
+  deallocate(void* __p, std::size_t __bytes, std::size_t __align)
+  {
+    if (!_M_pooled(__bytes, __align))
+    {
+      ::operator delete(__p);
+      return;
+    }
+    _Block* __b = static_cast<_Block*>(__p);
+    __b->next = iRemote.load(std::memory_order_relaxed);
+    while (!iRemote.compare_exchange_weak(__b->next, __b, std::memory_order_release, std::memory_order_relaxed))
+      ;
+    _M_unref();
+  }
+
+  /**
+   *  The owner gives up the pool.  It is deleted when the last block is
+   *  freed.
+   */
+  void
+  release()
+  { _M_unref(); }
+
+  /**
+   *  The owner drops the pool with all its chunks at once, whether blocks
+   *  are still live or not.  Nothing may refer to those blocks afterwards.
+   */
+  void
+  drop()
+  { delete this; }
+
+  /**  Returns the number of blocks handed out and not yet freed.  */
+  std::size_t
+  live() const
+  { return iRefs.load(std::memory_order_acquire) - 1; }
+
+  /**
+   *  Returns true if every slot of [__first, __last) points into a chunk
+   *  of this pool; NULL slots do not.  O(chunks log chunks + n log chunks).
+   */
+  template<typename _Iterator>
+  bool
+  owns(_Iterator __first, _Iterator __last) const
+  {
+    std::vector<const char*> __chunks;
+    __chunks.reserve(iChunkCount);
+    for (_Chunk* __c = iChunks; __c; __c = __c->next)
+      __chunks.push_back(reinterpret_cast<const char*>(__c));
+    std::sort(__chunks.begin(), __chunks.end(), std::less<const char*>());
+    const std::size_t __bytes = _S_round(sizeof(_Chunk)) + iBlockSize * iBlocksPerChunk;
+    for ( ; __first != __last; ++__first)
+    {
+      const char* __p = static_cast<const char*>(static_cast<const void*>(__first->get()));
+      auto __i = std::upper_bound(__chunks.begin(), __chunks.end(), __p, std::less<const char*>());
+      if (!__p || __i == __chunks.begin() || !std::less<const char*>()(__p, *--__i + __bytes))
+        return false;
+    }
+    return true;
+  }
+
+  std::size_t
+  block_size() const
+  { return iBlockSize; }
+
+  std::size_t
+  blocks_per_chunk() const
+  { return iBlocksPerChunk; }
+
+  std::size_t
+  chunks() const
+  { return iChunkCount; }
+
+private:
+  struct _Block { _Block* next; };
+  struct _Chunk { _Chunk* next; };
+
+  ~shared_ptr_pool()
+  {
+    while (iChunks)
+    {
+      _Chunk* __c = iChunks;
+      iChunks = __c->next;
+      ::operator delete(__c);
+    }
+  }
+
+  static std::size_t
+  _S_round(std::size_t __n)
+  {
+    const std::size_t __a = alignof(std::max_align_t);
+    return (__n + __a - 1) / __a * __a;
+  }
+
+  bool
+  _M_pooled(std::size_t __bytes, std::size_t __align) const
+  { return __align <= alignof(std::max_align_t) && __bytes != 0 && _S_round(__bytes) == iBlockSize; }
+
+  void
+  _M_new_chunk()
+  {
+    const std::size_t __head = _S_round(sizeof(_Chunk));
+    char* __m = static_cast<char*>(::operator new(__head + iBlockSize * iBlocksPerChunk));
+    _Chunk* __c = reinterpret_cast<_Chunk*>(__m);
+    __c->next = iChunks;
+    iChunks = __c;
+    ++iChunkCount;
+    iCur = __m + __head;
+    iEnd = iCur + iBlockSize * iBlocksPerChunk;
+  }
+
+  void
+  _M_unref()
+  {
+    if (iRefs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete this;
+  }
+
+  std::atomic<std::size_t> iRefs;   // the owner + live blocks
+  std::atomic<_Block*>     iRemote; // freed blocks, pushed from any thread
+  _Block*                  iFree;   // owner side free list
+  _Chunk*                  iChunks;
+  char*                    iCur;
+  char*                    iEnd;
+  std::size_t              iBlockSize;
+  std::size_t              iBlocksPerChunk;
+  std::size_t              iChunkCount;
+};
+
+/**
+ *  @brief  An allocator which takes its memory from a shared_ptr_pool.
+ *
+ *  Used with std::allocate_shared so that an element and its control
+ *  block come from the pool.
+ */
+template<typename _Up>
+struct shared_ptr_pool_allocator
+{
+  typedef _Up value_type;
+
+  explicit
+  shared_ptr_pool_allocator(shared_ptr_pool* __p) noexcept
+  : iPool(__p)
+  { }
+
+  template<typename _Vp>
+  shared_ptr_pool_allocator(const shared_ptr_pool_allocator<_Vp>& __a) noexcept
+  : iPool(__a.iPool)
+  { }
+
+  _Up*
+  allocate(std::size_t __n)
+  { return static_cast<_Up*>(iPool->allocate(__n * sizeof(_Up), alignof(_Up))); }
+
+  void
+  deallocate(_Up* __p, std::size_t __n)
+  { iPool->deallocate(__p, __n * sizeof(_Up), alignof(_Up)); }
+
+  shared_ptr_pool* iPool;
+};
+
+template<typename _Up, typename _Vp>
+inline bool
+operator==(const shared_ptr_pool_allocator<_Up>& __x, const shared_ptr_pool_allocator<_Vp>& __y)
+{ return __x.iPool == __y.iPool; }
+
+template<typename _Up, typename _Vp>
+inline bool
+operator!=(const shared_ptr_pool_allocator<_Up>& __x, const shared_ptr_pool_allocator<_Vp>& __y)
+{ return __x.iPool != __y.iPool; }
+
+/**
+ *  @brief  Execution policy for the parallel sort and find functions of
+ *          shared_ptr_vector.
+ *
+ *  The work is split among @a threads threads, the calling one included.
+ *  0 means std::thread::hardware_concurrency().  Ranges shorter than
+ *  @a grain elements per thread use fewer threads.
+ */
+struct shared_ptr_vector_parallel
+{
+  explicit
+  shared_ptr_vector_parallel(unsigned __threads = 0, std::size_t __grain = 16384)
+  : threads(__threads ? __threads : std::thread::hardware_concurrency())
+  , grain(__grain ? __grain : 1)
+  {
+    if (threads == 0)
+      threads = 1;
+  }
+
+  /**
+   *  @brief  Runs __f(0) .. __f(__k - 1), each in its own thread.
+   *
+   *  __f(0) runs in the calling thread.  The first exception thrown is
+   *  rethrown after all threads have finished.
+   */
+  template<typename _Fn>
+  static void
+  run(unsigned __k, _Fn __f)
+  {
+    std::vector<std::thread> __t;
+    std::vector<std::exception_ptr> __e(__k);
+    __t.reserve(__k);
+    for (unsigned __i = 1; __i < __k; ++__i)
+      __t.emplace_back([&__f, &__e, __i]
+                       {
+                         try { __f(__i); }
+                         catch (...) { __e[__i] = std::current_exception(); }
+                       });
+    try { __f(0); }
+    catch (...) { __e[0] = std::current_exception(); }
+    for (auto __i = __t.begin(); __i != __t.end(); ++__i)
+      __i->join();
+    for (auto __i = __e.begin(); __i != __e.end(); ++__i)
+      if (*__i)
+        std::rethrow_exception(*__i);
+  }
+
+  /**  Returns how many threads to use for __n elements.  */
+  unsigned
+  split(std::size_t __n) const
+  {
+    const std::size_t __k = __n / grain;
+    return __k < threads ? (__k ? unsigned(__k) : 1) : threads;
+  }
+
+  unsigned    threads;
+  std::size_t grain;
+};
+
+/**
+ *  @brief  Maps an arithmetic key to an unsigned integer of the same size
+ *          with the same order, for radix sorting.
+ *
+ *  Signed integers get their sign bit flipped; floating point numbers
+ *  get all bits flipped if negative and the sign bit set otherwise.
+ */
+template<typename _Key, typename = void>
+struct shared_ptr_vector_radix_key;
+
+template<typename _Key>
+struct shared_ptr_vector_radix_key<_Key, typename std::enable_if<std::is_integral<_Key>::value && !std::is_same<_Key, bool>::value>::type>
+{
+  typedef typename std::make_unsigned<_Key>::type type;
+
+  static type
+  encode(_Key __k)
+  {
+    if (std::is_signed<_Key>::value)
+      return type(__k) ^ (type(1) << (sizeof(type) * 8 - 1));
+    return type(__k);
+  }
+};
+
+template<>
+struct shared_ptr_vector_radix_key<bool>
+{
+  typedef unsigned char type;
+
+  static type
+  encode(bool __k)
+  { return __k; }
+};
+
+template<typename _Key>
+struct shared_ptr_vector_radix_key<_Key, typename std::enable_if<std::is_floating_point<_Key>::value && (sizeof(_Key) == 4 || sizeof(_Key) == 8)>::type>
+{
+  typedef typename std::conditional<sizeof(_Key) == 4, std::uint32_t, std::uint64_t>::type type;
+
+  static type
+  encode(_Key __k)
+  {
+    type __b;
+    std::memcpy(&__b, &__k, sizeof(__b));
+    const type __sign = type(1) << (sizeof(type) * 8 - 1);
+    return (__b & __sign) ? ~__b : (__b | __sign);
+  }
+};
+
+/**
+ *  @brief  Resets a recycled element for its reuse by emplace_back.
+ *
+ *  The default assigns a new _Tp built from the arguments.  Specialize it
+ *  to reuse the resources of the element (buffers, capacity) instead.
+ */
+template<typename _Tp>
+struct shared_ptr_vector_recycle
+{
+  template<typename... _Args>
+  static auto
+  reset(_Tp& __x, _Args&&... __args) -> decltype(void(__x = _Tp(std::forward<_Args>(__args)...)))
+  { __x = _Tp(std::forward<_Args>(__args)...); }
+};
+
+/**
+ *  @brief  Writes and reads an element for shared_ptr_vector::serialize
+ *          and shared_ptr_vector::deserialize.
+ *
+ *  The default copies the bytes of a trivially copyable _Tp.  Specialize
+ *  it for other types:
+ *  @code
+ *  template<>
+ *  struct shared_ptr_vector_serial<Obj>
+ *  {
+ *    template<typename _Writer> static void write(_Writer& __w, const Obj& __x);
+ *    template<typename _Reader> static Obj read(_Reader& __r);
+ *  };
+ *  @endcode
+ *  A _Writer has write(const char*, size), and a _Reader read(char*, size),
+ *  as std::ostream and std::istream do.
+ */
+template<typename _Tp, typename = void>
+struct shared_ptr_vector_serial;
+
+template<typename _Tp>
+struct shared_ptr_vector_serial<_Tp, typename std::enable_if<std::is_trivially_copyable<_Tp>::value>::type>
+{
+  template<typename _Writer>
+  static void
+  write(_Writer& __w, const _Tp& __x)
+  { __w.write(reinterpret_cast<const char*>(&__x), sizeof(_Tp)); }
+
+  template<typename _Reader>
+  static _Tp
+  read(_Reader& __r)
+  {
+    char __b[sizeof(_Tp)];
+    __r.read(__b, sizeof(_Tp));
+    _Tp __x;
+    std::memcpy(&__x, __b, sizeof(_Tp));
+    return __x;
+  }
+};
+
+/**
+ *  @brief  Formats an element for to_string, operator<< and format_to
+ *          without a stream.
+ *
+ *  It is specialized for arithmetic types other than bool and the
+ *  character types, which are written by std::to_chars as operator<<
+ *  would write them with the default flags.  Other types go through
+ *  operator<< unless it is specialized for them:
+ *  @code
+ *  template<>
+ *  struct shared_ptr_vector_format<Obj>
+ *  {
+ *    static std::size_t size(const Obj& __x);       // at most this many chars
+ *    static char* format(char* __p, const Obj& __x); // returns the end
+ *  };
+ *  @endcode
+ */
+template<typename _Tp, typename = void>
+struct shared_ptr_vector_format
+{ };
+
+template<typename _Tp>
+struct shared_ptr_vector_format<_Tp, typename std::enable_if<std::is_integral<_Tp>::value
+    && !std::is_same<_Tp, bool>::value && !std::is_same<_Tp, char>::value
+    && !std::is_same<_Tp, signed char>::value && !std::is_same<_Tp, unsigned char>::value
+    && !std::is_same<_Tp, wchar_t>::value && !std::is_same<_Tp, char16_t>::value
+    && !std::is_same<_Tp, char32_t>::value>::type>
+{
+  static std::size_t
+  size(_Tp __x)
+  {
+    typedef typename std::make_unsigned<_Tp>::type _Up;
+    std::size_t __n = 1;
+    _Up __u = _Up(__x);
+    if (__x < 0)
+    {
+      __u = _Up(0) - __u;
+      ++__n;
+    }
+    for (; __u >= 10; __u /= 10)
+      ++__n;
+    return __n;
+  }
+
+  static char*
+  format(char* __p, _Tp __x)
+  { return std::to_chars(__p, __p + std::numeric_limits<_Tp>::digits10 + 2, __x).ptr; }
+};
+
+template<typename _Tp>
+struct shared_ptr_vector_format<_Tp, typename std::enable_if<std::is_floating_point<_Tp>::value>::type>
+{
+  // sign, 6 digits, point, and an exponent of up to 4 digits
+  static constexpr std::size_t _S_max = 16;
+
+  static std::size_t
+  size(_Tp)
+  { return _S_max; }
+
+  static char*
+  format(char* __p, _Tp __x)
+  { return std::to_chars(__p, __p + _S_max, __x, std::chars_format::general, 6).ptr; }
+};
+
+/// True if shared_ptr_vector_format<_Tp> has size() and format().
+template<typename _Tp, typename = void>
+struct shared_ptr_vector_formattable : std::false_type { };
+
+template<typename _Tp>
+struct shared_ptr_vector_formattable<_Tp, decltype(void(shared_ptr_vector_format<_Tp>::size(std::declval<const _Tp&>())))>
+: std::true_type { };
+
+/**
+ *  Tag to construct a shared_ptr_vector whose elements come from its own
+ *  shared_ptr_pool.
+ */
+struct shared_ptr_vector_pool_t { };
+constexpr shared_ptr_vector_pool_t shared_ptr_vector_pool { };
+
+/**
+ *  @brief  Ownership policy which keeps the elements in std::shared_ptr.
+ *
+ *  The reference counts are atomic, so elements may be shared between
+ *  threads.  This is the default.
+ */
+template<typename _Tp>
+struct shared_ptr_policy
+{
+  typedef std::shared_ptr<_Tp> pointer;
+
+  template<typename... _Args>
+  static pointer
+  make(_Args&&... __args)
+  { return std::make_shared<_Tp>(std::forward<_Args>(__args)...); }
+
+  template<typename _ElemAlloc, typename... _Args>
+  static pointer
+  allocate(const _ElemAlloc& __a, _Args&&... __args)
+  { return std::allocate_shared<_Tp>(__a, std::forward<_Args>(__args)...); }
+};
+
+/**
+ *  @brief  Ownership policy which keeps the elements in local_shared_ptr.
+ *
+ *  The reference counts are not atomic, so copies, sorts and clears do no
+ *  lock-prefixed instructions.  The shared_ptr_vector and every pointer to
+ *  its elements must be used by one thread at a time.
+ */
+template<typename _Tp>
+struct local_ptr_policy
+{
+  typedef local_shared_ptr<_Tp> pointer;
+
+  template<typename... _Args>
+  static pointer
+  make(_Args&&... __args)
+  { return make_local_shared<_Tp>(std::forward<_Args>(__args)...); }
+
+  template<typename _ElemAlloc, typename... _Args>
+  static pointer
+  allocate(const _ElemAlloc& __a, _Args&&... __args)
+  { return allocate_local_shared<_Tp>(__a, std::forward<_Args>(__args)...); }
+};
+
+/**
+ *  @brief  Ownership policy which keeps the elements in
+ *          intrusive_shared_ptr.
+ *
+ *  A slot is a single pointer and there is no control block; _Tp keeps
+ *  its own count (see intrusive_shared_ptr).  Elements are made with
+ *  new and freed by intrusive_release, so element allocators and the
+ *  element pool are not used.
+ */
+template<typename _Tp>
+struct intrusive_ptr_policy
+{
+  typedef intrusive_shared_ptr<_Tp> pointer;
+
+  template<typename... _Args>
+  static pointer
+  make(_Args&&... __args)
+  { return pointer(new _Tp(std::forward<_Args>(__args)...)); }
+
+  template<typename _ElemAlloc, typename... _Args>
+  static pointer
+  allocate(const _ElemAlloc&, _Args&&... __args)
+  { return make(std::forward<_Args>(__args)...); }
+};
+
+/**
+ *  The default ownership policy for _Tp: intrusive_ptr_policy if _Tp
+ *  has intrusive_add_ref and intrusive_release, else shared_ptr_policy.
+ */
+template<typename _Tp>
+struct default_ptr_policy
+{
+  typedef typename std::conditional<has_intrusive_ref_count<_Tp>::value,
+                                    intrusive_ptr_policy<_Tp>,
+                                    shared_ptr_policy<_Tp> >::type type;
+};
 
-template<typename _Tp, typename _Alloc = std::allocator<std::shared_ptr<_Tp> > >
+template<typename _Tp, typename _Alloc = std::allocator<std::shared_ptr<_Tp> >, typename _Policy = typename default_ptr_policy<_Tp>::type>
 class shared_ptr_vector
 {
 public:
-  typedef std::vector<std::shared_ptr<_Tp>, _Alloc> _vector_type;
+  typedef typename _Policy::pointer shared_data_type;
+  typedef std::vector<shared_data_type, typename std::allocator_traits<_Alloc>::template rebind_alloc<shared_data_type> > _vector_type;
+  // the slots: relocated bitwise unless the allocator is not std::allocator
+  typedef typename std::conditional<shared_ptr_spine_relocatable<shared_data_type, typename _vector_type::allocator_type>::value,
+                                    shared_ptr_spine<shared_data_type, typename _vector_type::allocator_type>,
+                                    _vector_type>::type _spine_type;
 
   typedef _Tp                  value_type;
   typedef _Tp*                 data_type;
   typedef const _Tp*           const_data_type;
-  typedef std::shared_ptr<_Tp> shared_data_type;
 
 //typedef typename _vector_type::pointer                pointer;
 //typedef typename _vector_type::const_pointer          const_pointer;
@@ -54,22 +634,44 @@ public:
   typedef data_type                                     reference;
   typedef const_data_type                               const_reference;
 
-  typedef typename _vector_type::iterator               iterator;
-  typedef typename _vector_type::const_iterator         const_iterator;
-  typedef typename _vector_type::reverse_iterator       reverse_iterator;
-  typedef typename _vector_type::const_reverse_iterator const_reverse_iterator;
+  typedef typename _spine_type::iterator               iterator;
+  typedef typename _spine_type::const_iterator         const_iterator;
+  typedef typename _spine_type::reverse_iterator       reverse_iterator;
+  typedef typename _spine_type::const_reverse_iterator const_reverse_iterator;
 
-  typedef typename _vector_type::size_type       size_type;
-  typedef typename _vector_type::difference_type difference_type;
-  typedef typename _vector_type::allocator_type  allocator_type;
+  typedef typename _spine_type::size_type       size_type;
+  typedef typename _spine_type::difference_type difference_type;
+  typedef typename _spine_type::allocator_type  allocator_type;
 
   friend class Tests;
 
-#define _DEBUG_OUT
-#ifdef _DEBUG_OUT
-#define _OUT(m) std::cout << m << std::endl
+// Trace points: see shared_ptr_vector_trace.h
+#ifdef SHARED_PTR_VECTOR_TRACE
+#define _SPV_TRACE(op) shared_ptr_vector_trace_scope<shared_ptr_vector> __trace(shared_ptr_vector_op::op, this)
+#else
+#define _SPV_TRACE(op)
+#endif
+
+// Counting points: see shared_ptr_vector_stats.h.  They are in _Slots,
+// which every change of the spine goes through, and in the helpers which
+// make, copy or release a slot.  _SPV_STATS_SPINE(s) counts the changes
+// of the spine s over the scope, _SPV_STATS_MOVE(s) too but without
+// counting a reallocation, _SPV_STATS_NEW() from empty, and
+// _SPV_STATS_FILL(n, x) n copies of the slot x, which is then dropped.
+#ifdef SHARED_PTR_VECTOR_STATS
+#define _SPV_STATS(counter, n) _M_stats(shared_ptr_vector_counter::counter, (n))
+#define _SPV_STATS_CAT2(a, b) a##b
+#define _SPV_STATS_CAT(a, b) _SPV_STATS_CAT2(a, b)
+#define _SPV_STATS_SPINE(s) _StatsSpine _SPV_STATS_CAT(__stats_, __LINE__)(s, true)
+#define _SPV_STATS_MOVE(s) _StatsSpine _SPV_STATS_CAT(__stats_, __LINE__)(s, false)
+#define _SPV_STATS_NEW() _StatsSpine __stats_new(this, 0, 0)
+#define _SPV_STATS_FILL(n, x) _M_stats_fill((n), (x))
 #else
-#define _OUT(m)
+#define _SPV_STATS(counter, n)
+#define _SPV_STATS_SPINE(s)
+#define _SPV_STATS_MOVE(s)
+#define _SPV_STATS_NEW()
+#define _SPV_STATS_FILL(n, x)
 #endif
 
 public:
@@ -80,8 +682,9 @@ public:
    *  @brief  Creates a shared_ptr_vector with no elements.
    */
   shared_ptr_vector()
+  : iList(iStats)
   {
-    _OUT(" + shared_ptr_vector() default ctor called");
+    _SPV_TRACE(ctor);
   }
 
   /**
@@ -90,9 +693,26 @@ public:
    */
   explicit
   shared_ptr_vector(const allocator_type& __a)
-  : iList(__a)
+  : iList(iStats, __a)
+  {
+    _SPV_TRACE(ctor);
+  }
+
+  /**
+   *  @brief  Creates a shared_ptr_vector with no elements whose elements
+   *          are allocated from a pool.
+   *  @param  __blocks_per_chunk  Number of elements per pool chunk.
+   *  @param  __a  An allocator object.
+   *
+   *  emplace_back(), emplace() and push_back(value_type) take the element
+   *  and its control block from a shared_ptr_pool owned by the
+   *  shared_ptr_vector.  See also release_all().
+   */
+  shared_ptr_vector(shared_ptr_vector_pool_t, size_type __blocks_per_chunk = 1024, const allocator_type& __a = allocator_type())
+  : iList(iStats, __a)
+  , iPool(new shared_ptr_pool(__blocks_per_chunk))
   {
-    _OUT(" + shared_ptr_vector(const allocator_type& __a)) ctor called");
+    _SPV_TRACE(ctor);
   }
 
   /**
@@ -105,9 +725,9 @@ public:
    */
   explicit
   shared_ptr_vector(size_type __n, const allocator_type& __a = allocator_type())
-  : iList(__n, __a)
+  : iList(iStats, __n, __a)
   {
-    _OUT(" + shared_ptr_vector(size_type __n, cconst allocator_type& __a)) ctor called");
+    _SPV_TRACE(ctor);
   }
 
   /**
@@ -120,9 +740,9 @@ public:
    */
 //shared_ptr_vector(size_type __n, const value_type& __value, const allocator_type& __a = allocator_type())
   shared_ptr_vector(size_type __n, const data_type& __value, const allocator_type& __a = allocator_type())
-  : iList(__n, shared_data_type(__value), __a)
+  : iList(iStats, __n, _M_slot(__value), __a)
   {
-    _OUT(" + shared_ptr_vector(size_type __n, const data_type& __value, ccconst allocator_type& __a)) ctor called");
+    _SPV_TRACE(ctor);
   }
 
   /**
@@ -137,9 +757,10 @@ public:
    *  by @a __x (unless the allocator traits dictate a different object).
    */
   shared_ptr_vector(const shared_ptr_vector& __x)
-  : iList(__x.iList)
+  : iList(iStats, __x.iList)
+  , iPool(__x.iPool ? new shared_ptr_pool(__x.iPool->blocks_per_chunk()) : nullptr)
   {
-    _OUT(" + shared_ptr_vector(const shared_ptr_vector& __x) ctor called");
+    _SPV_TRACE(copy_ctor);
   }
 
   /**
@@ -152,23 +773,32 @@ public:
    */
 //shared_ptr_vector(shared_ptr_vector&&) noexcept = default;
   shared_ptr_vector(shared_ptr_vector&& __x)
-  : iList(std::move(__x.iList))
+  : iList(iStats, std::move(__x.iList))
+  , iPool(__x.iPool)
+  , iIndex(std::move(__x.iIndex))
+  , iRecycle(std::move(__x.iRecycle))
   {
+    __x.iPool = nullptr;
   }
 
   /// Copy constructor with alternative allocator
   shared_ptr_vector(const shared_ptr_vector& __x, const allocator_type& __a)
-  : iList(__x.List, __a)
+  : iList(iStats, __x.iList, __a)
+  , iPool(__x.iPool ? new shared_ptr_pool(__x.iPool->blocks_per_chunk()) : nullptr)
   {
-    _OUT(" + shared_ptr_vector(const shared_ptr_vector& __x, const allocator_type& __a)) ctor called");
+    _SPV_TRACE(copy_ctor);
   }
 
 public:
   /// Move constructor with alternative allocator
   shared_ptr_vector(shared_ptr_vector&& __rv, const allocator_type& __m)
 //noexcept( noexcept( shared_ptr_vector(std::declval<shared_ptr_vector&&>(), std::declval<const allocator_type&>(), std::declval<typename _Alloc_traits::is_always_equal>())) )
-  : iList(std::move(__rv.iList), __m)
+  : iList(iStats, std::move(__rv.iList), __m)
+  , iPool(__rv.iPool)
+  , iIndex(std::move(__rv.iIndex))
+  , iRecycle(std::move(__rv.iRecycle))
   {
+    __rv.iPool = nullptr;
   }
 
   /**
@@ -184,10 +814,10 @@ public:
    */
 //shared_ptr_vector(initializer_list<value_type> __l, const allocator_type& __a = allocator_type())
   shared_ptr_vector(std::initializer_list<data_type> __l, const allocator_type& __a = allocator_type())
-  : iList(__a)
+  : iList(iStats, __a)
   {
-    _OUT(" + shared_ptr_vector(std::initializer_list<data_type> __l, const allocator_type& __a) ctor called");
-    iList.reserve(__l.size());
+    _SPV_TRACE(ctor);
+    this->reserve(__l.size());
     //for (auto i : __l)
     //  this->push_back(i);
     for (auto i = __l.begin(); i != __l.end(); ++i)
@@ -212,10 +842,10 @@ public:
    */
   template<typename _InputIterator>
   shared_ptr_vector(_InputIterator __first, _InputIterator __last, const allocator_type& __a = allocator_type())
-  : iList(__a)
+  : iList(iStats, __a)
   {
-    _OUT(" + shared_ptr_vector(_InputIterator __first, _InputIterator __last, const allocator_type& __a) ctor called");
-    iList.reserve(__last - __first);
+    _SPV_TRACE(ctor);
+    this->reserve(__last - __first);
     for ( ; __first != __last; ++__first)
       this->push_back(*__first);
   }
@@ -228,7 +858,14 @@ public:
    */
   ~shared_ptr_vector()
   {
-    _OUT(" - ~shared_ptr_vector() dtor called");
+    _SPV_TRACE(dtor);
+    // the slots go within the body, so that the trace of dtor covers them
+    iList.clear(iReclaimer);
+    _M_trim_recycled(0);
+    if (iRetired)
+      iRetired->release();
+    if (iPool)
+      iPool->release();
   }
 
 public:
@@ -244,8 +881,9 @@ public:
   shared_ptr_vector&
   operator=(const shared_ptr_vector& __x)
   {
-    _OUT(" + operator=(const shared_ptr_vector& __x) called");
+    _SPV_TRACE(copy_assign);
     iList = __x.iList;
+    _M_index_dirty();
     return *this;
   }
 
@@ -262,8 +900,17 @@ public:
   shared_ptr_vector&
   operator=(shared_ptr_vector&& __x) //noexcept(_vector_type::_Alloc_traits::_S_nothrow_move())
   {
-    _OUT(" + operator=(const shared_ptr_vector&& __x) noexcept called");
+    _SPV_TRACE(move_assign);
     iList = std::move(__x.iList);
+    _M_index_dirty();
+    __x._M_index_dirty();
+    // the free list goes with the elements, as in the move constructors
+    _M_trim_recycled(0);
+    iRecycle = std::move(__x.iRecycle);
+    if (iPool)
+      iPool->release();
+    iPool = __x.iPool;
+    __x.iPool = nullptr;
     return *this;
   }
 
@@ -281,8 +928,8 @@ public:
   shared_ptr_vector&
   operator=(std::initializer_list<data_type> __l)
   {
-    _OUT(" + operator=(std::initializer_list<data_type> __l) called");
-    iList.reserve(__l.size());
+    _SPV_TRACE(assign);
+    this->reserve(__l.size());
     //for (auto i : __l)
     //  this->push_back(i);
     for (auto i = __l.begin(); i != __l.end(); ++i)
@@ -303,8 +950,9 @@ public:
   void
   assign(size_type __n, const data_type& __val)
   {
-    _OUT(" * assign(size_type __n, const data_type& __val) called");
-    iList.assign(__n, shared_data_type(__val));
+    _SPV_TRACE(assign);
+    iList.assign(__n, _M_slot(__val));
+    _M_index_dirty();
   }
 
   /**
@@ -323,7 +971,7 @@ public:
   void
   assign(_InputIterator __first, _InputIterator __last)
   {
-    _OUT(" * assign(_InputIterator __first, _InputIterator __last) called");
+    _SPV_TRACE(assign);
     for ( ; __first != __last; ++__first)
       this->push_back(*__first);
   }
@@ -342,7 +990,7 @@ public:
   void
   assign(std::initializer_list<data_type> __l)
   {
-    _OUT(" * assign(std::initializer_list<data_type> __l) called");
+    _SPV_TRACE(assign);
     this->assign(__l.begin(), __l.end());
   }
 
@@ -508,8 +1156,9 @@ public:
   void
   resize(size_type __new_size)
   {
-    _OUT(" * resize(size_type __new_size) called");
+    _SPV_TRACE(resize);
     iList.resize(__new_size);
+    _M_index_dirty();
   }
 
   /**
@@ -526,8 +1175,9 @@ public:
   void
   resize(size_type __new_size, const data_type& __x)
   {
-    _OUT(" * resize(size_type __new_size, const value_type& __x) called");
-    iList.resize(__new_size, shared_data_type(__x));
+    _SPV_TRACE(resize);
+    iList.resize(__new_size, _M_slot(__x));
+    _M_index_dirty();
   }
 
   /**  A non-binding request to reduce capacity() to size().  */
@@ -636,8 +1286,11 @@ public:
   reference
   at(size_type __n, const data_type& __x)
   {
-    iList.at(__n) = shared_data_type(__x);
-    return iList.at(__n).get();
+    shared_data_type& __slot = iList.at(__n);
+    _M_index_remove(__n);
+    iList.replace(__slot, _M_slot(__x));
+    _M_index_add(__n);
+    return __slot.get();
   }
 
   /**
@@ -731,27 +1384,111 @@ public:
   void
   push_back(const data_type& __x)
   {
-    iList.push_back(shared_data_type(__x));
+    iList.push_back(_M_slot(__x));
+    _M_index_add(size() - 1);
   }
 
   void
   push_back(data_type&& __x)
   {
-    iList.push_back(shared_data_type(__x));
+    iList.push_back(_M_slot(__x));
+    _M_index_add(size() - 1);
   }
 
   // my utility function for value_type
+  /**
+   *  @brief  Add a copy of a value to the end of the shared_ptr_vector.
+   *  @param  __x  Value to be copied.
+   *
+   *  The copy and its reference count are built in a single allocation
+   *  (see std::make_shared), taken from the pool if there is one.
+   */
   void
   push_back(const value_type& __x)
   {
-    iList.push_back(shared_data_type( new value_type(__x) ));
+    iList.push_back(_M_make(__x));
+    _M_index_add(size() - 1);
+  }
+
+  /**
+   *  @brief  Add a value to the end of the shared_ptr_vector by moving it.
+   *  @param  __x  Value to be moved.
+   *
+   *  The new element and its reference count are built in a single
+   *  allocation (see std::make_shared), taken from the pool if there is one.
+   */
+  void
+  push_back(value_type&& __x)
+  {
+    iList.push_back(_M_make(std::move(__x)));
+    _M_index_add(size() - 1);
+  }
+
+  /**
+   *  @brief  Moves a shared_data_type to the end of the shared_ptr_vector.
+   *  @param  __x  A shared_data_type, empty afterwards.
+   *
+   *  The ownership moves, so the reference count is not touched.
+   */
+  void
+  push_back(shared_data_type&& __x)
+  {
+    iList.push_back(std::move(__x));
+    _M_index_add(size() - 1);
   }
 
+  /**
+   *  @brief  Constructs an object at the end of the shared_ptr_vector.
+   *  @param  __args  Arguments forwarded to the constructor of _Tp.
+   *  @return  Pointer to the constructed object.
+   *
+   *  The object and its reference count are built in a single allocation
+   *  (see std::make_shared), so only one allocation is made per element.
+   *  It is taken from the pool if there is one.  With recycling on, an
+   *  element of the free list is reset and reused instead (see
+   *  enable_recycling()).
+   */
   template<typename... _Args>
   reference
   emplace_back(_Args&&... __args)
   {
-    this->push_back(new _Tp(__args...));
+    if constexpr (decltype(_S_resettable<_Args...>(0))::value)
+    {
+      if (iRecycle && !iRecycle->free.empty())
+      {
+        ++iRecycle->hits;
+        shared_data_type __p(std::move(iRecycle->free.back()));
+        iRecycle->free.pop_back();
+        shared_ptr_vector_recycle<_Tp>::reset(*__p, std::forward<_Args>(__args)...);
+        iList.push_back(std::move(__p));
+        _M_index_add(size() - 1);
+        return this->back();
+      }
+      if (iRecycle)
+        ++iRecycle->misses;
+    }
+    iList.push_back(_M_make(std::forward<_Args>(__args)...));
+    _M_index_add(size() - 1);
+    return this->back();
+  }
+
+  /**
+   *  @brief  Constructs an object at the end of the shared_ptr_vector
+   *          using an allocator.
+   *  @param  __a  An allocator used for the object and its reference count.
+   *  @param  __args  Arguments forwarded to the constructor of _Tp.
+   *  @return  Pointer to the constructed object.
+   *
+   *  Same as emplace_back() but the single allocation is done by @a __a
+   *  (see std::allocate_shared).  @a __a governs the elements only; the
+   *  shared_ptr_vector itself still uses allocator_type.
+   */
+  template<typename _ElemAlloc, typename... _Args>
+  reference
+  allocate_back(const _ElemAlloc& __a, _Args&&... __args)
+  {
+    iList.push_back(_M_allocate(__a, std::forward<_Args>(__args)...));
+    _M_index_add(size() - 1);
     return this->back();
   }
 
@@ -767,6 +1504,9 @@ public:
   void
   pop_back()
   {
+    _M_index_erase(size() - 1);
+    _M_recycle(iList.back());
+    _M_retire(iList.back());
     iList.pop_back();
   }
 
@@ -787,8 +1527,29 @@ public:
   iterator
   emplace(const_iterator __position, _Args&&... __args)
   {
-    //return iList.implace(__position, __args...);
-    return iList.insert(__position, shared_data_type(new _Tp(__args...)));
+    iterator __r = iList.insert(__position, _M_make(std::forward<_Args>(__args)...));
+    _M_index_insert(__r - begin());
+    return __r;
+  }
+
+  /**
+   *  @brief  Inserts an object in shared_ptr_vector before specified
+   *          iterator using an allocator.
+   *  @param  __position  A const_iterator into the shared_ptr_vector.
+   *  @param  __a  An allocator used for the object and its reference count.
+   *  @param  __args  Arguments.
+   *  @return  An iterator that points to the inserted data.
+   *
+   *  Same as emplace() but the object is allocated by @a __a
+   *  (see std::allocate_shared).
+   */
+  template<typename _ElemAlloc, typename... _Args>
+  iterator
+  allocate_emplace(const_iterator __position, const _ElemAlloc& __a, _Args&&... __args)
+  {
+    iterator __r = iList.insert(__position, _M_allocate(__a, std::forward<_Args>(__args)...));
+    _M_index_insert(__r - begin());
+    return __r;
   }
 
   /**
@@ -805,8 +1566,10 @@ public:
   iterator
   insert(const_iterator __position, const data_type& __x)
   {
-    _OUT(" * insert(const_iterator __position, const data_type& __x) called");
-    return iList.insert(__position, shared_data_type(__x));
+    _SPV_TRACE(insert);
+    iterator __r = iList.insert(__position, _M_slot(__x));
+    _M_index_insert(__r - begin());
+    return __r;
   }
 
   /**
@@ -824,8 +1587,28 @@ public:
   insert(const_iterator __position, data_type&& __x)
   {
     //return iList.insert(__position, __x);
-    _OUT(" * insert(const_iterator __position, value_type&& __x) called");
-    return iList.insert(__position, shared_data_type(__x));
+    _SPV_TRACE(insert);
+    iterator __r = iList.insert(__position, _M_slot(__x));
+    _M_index_insert(__r - begin());
+    return __r;
+  }
+
+  /**
+   *  @brief  Moves a shared_data_type into shared_ptr_vector before
+   *          specified iterator.
+   *  @param  __position  A const_iterator into the shared_ptr_vector.
+   *  @param  __x  A shared_data_type, empty afterwards.
+   *  @return  An iterator that points to the inserted data.
+   *
+   *  The ownership moves, so the reference count is not touched.
+   */
+  iterator
+  insert(const_iterator __position, shared_data_type&& __x)
+  {
+    _SPV_TRACE(insert);
+    iterator __r = iList.insert(__position, std::move(__x));
+    _M_index_insert(__r - begin());
+    return __r;
   }
 
   /**
@@ -864,7 +1647,8 @@ public:
   iterator
   insert(const_iterator __position, size_type __n, const data_type& __x)
   {
-    return iList.insert(__position, __n, shared_data_type(__x));
+    _M_index_dirty();
+    return iList.insert(__position, __n, _M_slot(__x));
   }
 
   /**
@@ -878,24 +1662,19 @@ public:
    *  [__first,__last) into the shared_ptr_vector before the location specified
    *  by @a pos.
    *
-   *  Note that this kind of operation could be expensive for a
-   *  shared_ptr_vector and if it is frequently used the user should
-   *  consider using std::list.
+   *  The range may hold pointers (owned afterwards), shared_data_types
+   *  (shared, or moved through a std::move_iterator) or value_types
+   *  (copied into new elements).  For forward iterators the spine grows
+   *  once and the following elements are moved once: O(n + m).
    */
   template<typename _InputIterator>
   iterator
   insert(const_iterator __position, _InputIterator __first, _InputIterator __last)
   {
-    _OUT(" * insert(const_iterator __position, _InputIterator __first, _InputIterator __last) called");
-    //return iList.insert(__position, __first, __last);
-    difference_type d = end() - __position;
-    size_type n = std::distance(__first, __last);
-    resize(size() + n);
-    for (auto i = d; __first != __last; ++__first, ++i)
-    {
-      *(begin() + i) = shared_data_type(*__first);
-    }
-    return begin() + d;
+    _SPV_TRACE(insert);
+    _M_index_dirty();
+    return _M_range_insert(__position - cbegin(), __first, __last,
+                           typename std::iterator_traits<_InputIterator>::iterator_category());
   }
 
   /**
@@ -919,6 +1698,13 @@ public:
   iterator
   erase(const_iterator __position)
   {
+    _M_index_erase(__position - cbegin());
+    if (__position != cend())
+    {
+      shared_data_type& __slot = iList[__position - cbegin()];
+      _M_recycle(__slot);
+      _M_retire(__slot);
+    }
     return iList.erase(__position);
   }
 
@@ -946,6 +1732,19 @@ public:
   iterator
   erase(const_iterator __first, const_iterator __last)
   {
+    if (__last == cend())
+    {
+      for (size_type __i = __first - cbegin(); __i < size(); ++__i)
+        _M_index_remove(__i);
+    }
+    else
+      _M_index_dirty();
+    if (iRecycle)
+      for (size_type __i = __first - cbegin(); __i < size_type(__last - cbegin()); ++__i)
+        _M_recycle(iList[__i]);
+    if (iReclaimer)
+      for (size_type __i = __first - cbegin(); __i < size_type(__last - cbegin()); ++__i)
+        _M_retire(iList[__i]);
     return iList.erase(__first, __last);
   }
 
@@ -964,171 +1763,1665 @@ public:
   swap(shared_ptr_vector& __x)
   {
     iList.swap(__x.iList);
+    std::swap(iPool, __x.iPool);
+    iIndex.swap(__x.iIndex);
+    iRecycle.swap(__x.iRecycle);
   }
 
   /**
-   *  Erases all the elements.  Note that this function only erases the
-   *  elements, and that if the elements themselves are pointers, the
-   *  pointed-to memory is not touched in any way.  Managing the pointer is
-   *  the user's responsibility.
+   *  @brief  Moves a range of slots from another shared_ptr_vector.
+   *  @param  __position  A const_iterator into this shared_ptr_vector.
+   *  @param  __x  A shared_ptr_vector, which may be this one.
+   *  @param  __first  A const_iterator into @a __x.
+   *  @param  __last   A const_iterator into @a __x.
+   *  @return  An iterator that points to the first moved slot.
+   *
+   *  The slots [__first,__last) of @a __x are moved before @a __position
+   *  and erased from @a __x (see std::list::splice).  The slots are moved,
+   *  not copied, so no reference count is touched.  Within this
+   *  shared_ptr_vector the range is rotated into place.
    */
-  void
-  clear()
-  { iList.clear(); }
-
-public:
-  struct shared_ptr_data_equal
+  iterator
+  splice(const_iterator __position, shared_ptr_vector& __x, const_iterator __first, const_iterator __last)
   {
-    shared_ptr_data_equal(const data_type& __x)
-    : iData(__x)
-    { }
-
+    _SPV_TRACE(insert);
+    const size_type __off = __position - cbegin();
+    const size_type __f = __first - __x.cbegin();
+    const size_type __l = __last - __x.cbegin();
+    if (&__x == this)
+    {
+      _M_index_dirty();
+      if (__off < __f)
+        std::rotate(iList.begin() + __off, iList.begin() + __f, iList.begin() + __l);
+      else if (__off > __l)
+      {
+        std::rotate(iList.begin() + __f, iList.begin() + __l, iList.begin() + __off);
+        return begin() + (__off - (__l - __f));
+      }
+      else
+        return begin() + __f;
+      return begin() + __off;
+    }
+    _M_index_dirty();
+    __x._M_index_dirty();
+    _M_range_insert(__off, std::make_move_iterator(__x.iList.begin() + __f),
+                    std::make_move_iterator(__x.iList.begin() + __l), std::forward_iterator_tag());
+    __x.iList.erase(__x.iList.begin() + __f, __x.iList.begin() + __l);
+    return begin() + __off;
+  }
+
+  /**
+   *  @brief  Moves all the slots of another shared_ptr_vector.
+   *  @param  __position  A const_iterator into this shared_ptr_vector.
+   *  @param  __x  Another shared_ptr_vector, empty afterwards.
+   *  @return  An iterator that points to the first moved slot.
+   */
+  iterator
+  splice(const_iterator __position, shared_ptr_vector& __x)
+  {
+    return splice(__position, __x, __x.cbegin(), __x.cend());
+  }
+
+  /**
+   *  @brief  Moves a range of slots out into a new shared_ptr_vector.
+   *  @param  __first  A const_iterator into this shared_ptr_vector.
+   *  @param  __last   A const_iterator into this shared_ptr_vector.
+   *  @return  A shared_ptr_vector with the slots [__first,__last).
+   *
+   *  The slots are moved, not copied, so no reference count is touched.
+   *  The new shared_ptr_vector has no pool of its own.
+   */
+  shared_ptr_vector
+  extract(const_iterator __first, const_iterator __last)
+  {
+    const size_type __f = __first - cbegin();
+    const size_type __l = __last - cbegin();
+    shared_ptr_vector __r(iList.get_allocator());
+    __r.iList.reserve(__l - __f);
+    for (size_type __i = __f; __i < __l; ++__i)
+      __r.iList.push_back(std::move(iList[__i]));
+    iList.erase(iList.begin() + __f, iList.begin() + __l);
+    _M_index_dirty();
+    return __r;
+  }
+
+  /**
+   *  Erases all the elements.  Note that this function only erases the
+   *  elements, and that if the elements themselves are pointers, the
+   *  pointed-to memory is not touched in any way.  Managing the pointer is
+   *  the user's responsibility.
+   */
+  void
+  clear()
+  {
+    _SPV_TRACE(clear);
+    if (iRecycle)
+      for (auto __i = iList.begin(); __i != iList.end(); ++__i)
+        _M_recycle(*__i);
+    iList.clear(iReclaimer);
+    _M_index_dirty();
+  }
+
+  /**
+   *  @brief  Erases all the elements and drops the element pool.
+   *
+   *  If _Tp is trivially destructible, every live block of the pool is
+   *  in a slot, and every slot holds the only reference to its element,
+   *  the pool chunks are freed at once, without releasing the slots one
+   *  by one.  Otherwise, or without a pool, this is clear().  A fresh
+   *  pool is used afterwards.
+   *
+   *  @Note A weak_ptr to an element is not seen by the check, and must
+   *        not outlive this call.
+   */
+  void
+  release_all()
+  {
+    if (!iPool)
+    {
+      clear();
+      return;
+    }
+    const size_type __per_chunk = iPool->blocks_per_chunk();
+    if (std::is_trivially_destructible<_Tp>::value && iPool->live() == size() && _M_unique_pooled())
+    {
+      iList.forget();
+      _M_index_dirty();
+      iPool->drop();
+    }
+    else
+    {
+      clear();
+      iPool->release();
+    }
+    iPool = new shared_ptr_pool(__per_chunk);
+  }
+
+  /**  Returns the element pool, or NULL if elements come from operator new.  */
+  const shared_ptr_pool*
+  pool() const
+  { return iPool; }
+
+  /**
+   *  @brief  Defers the destruction of released slots.
+   *  @param  __r  A reclaimer which outlives this shared_ptr_vector, or
+   *               NULL to destroy released slots at once.
+   *
+   *  clear(), erase(), pop_back() and the destructor move the released
+   *  slots to @a __r instead of destroying them (see
+   *  shared_ptr_reclaimer).  The setting stays with this
+   *  shared_ptr_vector; copies, moves and swaps do not carry it.
+   *
+   *  erase() and pop_back() queue each slot in an entry of a cache kept
+   *  by this shared_ptr_vector, which the reclaimer gives back, so they
+   *  allocate only while the cache warms up.  clear() and the destructor
+   *  queue the whole spine in one entry.  If an entry cannot be
+   *  allocated, the slots are destroyed at once instead.
+   */
+  void
+  set_reclaimer(shared_ptr_reclaimer* __r)
+  {
+    if (__r && !iRetired)
+    {
+      iRetired = new shared_ptr_reclaimer_cache<shared_data_type>();
+      iRetired->reserve(_S_retire_reserve);
+    }
+    else if (!__r && iRetired)
+    {
+      iRetired->release();
+      iRetired = nullptr;
+    }
+    iReclaimer = __r;
+  }
+
+  /**  Returns the reclaimer, or NULL if released slots are destroyed at once.  */
+  shared_ptr_reclaimer*
+  reclaimer() const
+  { return iReclaimer; }
+
+  /**
+   *  @brief  Takes the slots of a vector of shared_data_types.
+   *  @param  __x  A vector, empty afterwards.
+   *
+   *  The elements of this shared_ptr_vector are released and the slots
+   *  of @a __x are moved in, so no reference count is touched.  Unless the
+   *  spine is a std::vector this is a relocation, O(n).
+   */
+  void
+  adopt(_vector_type&& __x)
+  {
+    _SPV_TRACE(assign);
+    if constexpr (std::is_same<_spine_type, _vector_type>::value)
+    {
+      iList.clear();
+      iList.swap(__x);
+    }
+    else
+    {
+      iList.clear();
+      iList.reserve(__x.size());
+      for (auto __i = __x.begin(); __i != __x.end(); ++__i)
+        iList.push_back(std::move(*__i));
+      __x.clear();
+    }
+    _M_index_dirty();
+  }
+
+  /**
+   *  @brief  Gives up the slots.
+   *  @return  The vector of shared_data_types.
+   *
+   *  The slots are moved out, so no reference count is touched.  Unless
+   *  the spine is a std::vector this is a relocation, O(n).
+   *  Afterwards this shared_ptr_vector is empty.
+   */
+  _vector_type
+  release()
+  {
+    _vector_type __r;
+    if constexpr (std::is_same<_spine_type, _vector_type>::value)
+      iList.swap(__r);
+    else
+    {
+      __r.reserve(size());
+      for (auto __i = iList.begin(); __i != iList.end(); ++__i)
+        __r.push_back(std::move(*__i));
+      iList.clear();
+    }
+    _M_index_dirty();
+    return __r;
+  }
+
+public:
+  // binary serialization
+  /**
+   *  @brief  Writes the elements in a binary form.
+   *  @param  __w  A writer with write(const char*, size), a std::ostream
+   *               for example.
+   *
+   *  Each element is written once by shared_ptr_vector_serial<_Tp>; a slot
+   *  which shares an element already written is written as a reference
+   *  to it, and a NULL slot as a 0.  Integers are in the byte order of
+   *  the machine.
+   */
+  template<typename _Writer>
+  void
+  serialize(_Writer& __w) const
+  {
+    __w.write(_S_serial_magic, sizeof(_S_serial_magic));
+    _S_put(__w, size());
+    // ids of the elements which may be shared, from 1
+    std::unordered_map<const_data_type, std::uint64_t> __ids;
+    std::uint64_t __next = 1;
+    for (auto __i = iList.begin(); __i != iList.end(); ++__i)
+    {
+      if (!*__i)
+      {
+        _S_put(__w, 0);
+        continue;
+      }
+      if (!_S_unique(*__i, 0))
+      {
+        auto __r = __ids.emplace(__i->get(), __next);
+        if (!__r.second)
+        {
+          _S_put(__w, __r.first->second);
+          continue;
+        }
+      }
+      _S_put(__w, __next++);
+      shared_ptr_vector_serial<_Tp>::write(__w, **__i);
+    }
+  }
+
+  /**
+   *  @brief  Reads elements written by serialize().
+   *  @param  __r  A reader with read(char*, size), a std::istream for
+   *               example.
+   *  @throw  std::runtime_error  If the input is not from serialize() or
+   *                              is cut short.
+   *
+   *  The elements replace those of this shared_ptr_vector.  NULL slots
+   *  come back NULL, and slots which shared an element share one again.
+   *  The slots are read into a new spine, so on an exception this
+   *  shared_ptr_vector is left as it was.  The count in the input is not
+   *  trusted for more than _S_serial_reserve slots ahead.
+   */
+  template<typename _Reader>
+  void
+  deserialize(_Reader& __r)
+  {
+    char __m[sizeof(_S_serial_magic)];
+    _S_get(__r, __m, sizeof(__m));
+    if (std::memcmp(__m, _S_serial_magic, sizeof(__m)) != 0)
+      throw std::runtime_error("shared_ptr_vector::deserialize: bad header");
+    const std::uint64_t __n = _S_get(__r);
+
+    _Slots __list(iStats, iList.get_allocator());
+    __list.reserve(size_type(std::min<std::uint64_t>(__n, _S_serial_reserve)));
+    // the position of the first slot of each element
+    std::vector<size_type> __objs;
+    for (std::uint64_t __k = 0; __k < __n; ++__k)
+    {
+      const std::uint64_t __id = _S_get(__r);
+      if (__id == 0)
+        __list.push_back(shared_data_type());
+      else if (__id <= __objs.size())
+        __list.push_back(_M_slot(__list[__objs[__id - 1]]));
+      else if (__id == __objs.size() + 1)
+      {
+        shared_data_type __p(_M_make(shared_ptr_vector_serial<_Tp>::read(__r)));
+        _S_check(__r);
+        __objs.push_back(__list.size());
+        __list.push_back(std::move(__p));
+      }
+      else
+        throw std::runtime_error("shared_ptr_vector::deserialize: bad reference");
+    }
+
+    clear();
+    iList.swap(__list);
+    _M_index_dirty();
+  }
+
+public:
+  struct shared_ptr_data_equal
+  {
+    shared_ptr_data_equal(const data_type& __x)
+    : iData(__x)
+    { }
+
     bool operator()(const shared_data_type& val) const
     {
       return iData == val.get();
     }
 
-  private:
-    const data_type iData;
-  };
-  struct shared_ptr_value_equal
+  private:
+    const data_type iData;
+  };
+  /**
+   *  Refers to the value, which must outlive the object.
+   */
+  struct shared_ptr_value_equal
+  {
+    shared_ptr_value_equal(const value_type& __x)
+    : iData(__x)
+    { }
+
+    bool operator()(const shared_data_type& val) const
+    {
+      if (val.get())
+        return *val.get() == iData;
+      else
+        return false;
+    }
+
+  private:
+    const value_type& iData;
+  };
+  /**
+   *  NULL is last element
+   */
+  struct shared_ptr_value_less
+  {
+    bool operator()(const shared_data_type& lhs, const shared_data_type& rhs) const
+    {
+      if (lhs.get() && rhs.get())
+        return *lhs.get() < *rhs.get();
+      else if (lhs.get())
+        return true;
+      else
+        return false;
+    }
+  };
+
+  /**
+   *  @brief  Sorts the elements.
+   *
+   *  A std::stable_sort with shared_ptr_value_less: equal elements keep
+   *  their order, so the result is slot for slot the one of
+   *  sort(const shared_ptr_vector_parallel&).  NULL is last element.
+   */
+  void
+  sort()
+  {
+   _SPV_TRACE(sort);
+   std::stable_sort(iList.begin(), iList.end(), shared_ptr_value_less());
+   _M_index_dirty();
+  }
+
+  /**
+   *  @brief  Sorts the elements in parallel.
+   *  @param  __par  The threads to use.
+   *
+   *  Each thread sorts one chunk, then adjacent chunks are merged in
+   *  parallel rounds.  Equal elements keep their order, so the result is
+   *  the same for any number of threads and is the one of a serial
+   *  std::stable_sort with shared_ptr_value_less.  NULL is last element.
+   */
+  void
+  sort(const shared_ptr_vector_parallel& __par)
+  {
+    _SPV_TRACE(sort);
+    const size_type __n = size();
+    const unsigned __k = __par.split(__n);
+    _M_index_dirty();
+    if (__k <= 1)
+    {
+      std::stable_sort(iList.begin(), iList.end(), shared_ptr_value_less());
+      return;
+    }
+
+    std::vector<size_type> __bounds(__k + 1);
+    for (unsigned __i = 0; __i <= __k; ++__i)
+      __bounds[__i] = __n * __i / __k;
+    shared_data_type* __a = iList.data();
+    shared_ptr_vector_parallel::run(__k, [&](unsigned __i)
+                                    {
+                                      std::stable_sort(__a + __bounds[__i], __a + __bounds[__i + 1], shared_ptr_value_less());
+                                    });
+
+    _Slots __buf(iStats, __n, iList.get_allocator());
+    shared_data_type* __from = iList.data();
+    shared_data_type* __to = __buf.data();
+    while (__bounds.size() > 2)
+    {
+      const unsigned __runs = __bounds.size() - 1;
+      shared_ptr_vector_parallel::run((__runs + 1) / 2, [&](unsigned __i)
+                                      {
+                                        const size_type __f = __bounds[2 * __i];
+                                        const size_type __m = __bounds[std::min(2 * __i + 1, __runs)];
+                                        const size_type __l = __bounds[std::min(2 * __i + 2, __runs)];
+                                        std::merge(std::make_move_iterator(__from + __f), std::make_move_iterator(__from + __m),
+                                                   std::make_move_iterator(__from + __m), std::make_move_iterator(__from + __l),
+                                                   __to + __f, shared_ptr_value_less());
+                                      });
+      std::vector<size_type> __next;
+      for (size_type __i = 0; __i < __bounds.size(); __i += 2)
+        __next.push_back(__bounds[__i]);
+      if (__next.back() != __n)
+        __next.push_back(__n);
+      __bounds.swap(__next);
+      std::swap(__from, __to);
+    }
+    if (__from != iList.data())
+      iList.swap(__buf);
+  }
+
+  /**
+   *  @brief  Sorts the elements by a key extracted once per element.
+   *  @param  __key  Function which returns the key of a value_type.
+   *  @param  __comp  Comparison of two keys, std::less by default.
+   *
+   *  The keys are extracted into a contiguous array of (key, index) pairs,
+   *  which is sorted without touching the elements; the slots are then
+   *  moved to their places in one pass.  Elements with equal keys keep
+   *  their order.  NULL is last element, as for sort().
+   *
+   *  Use this instead of sort() when comparing values is expensive or the
+   *  elements are scattered in memory and the key is small.
+   */
+  template<typename _KeyFn, typename _Compare = std::less<> >
+  void
+  sort_by_key(_KeyFn __key, _Compare __comp = _Compare())
+  {
+    _SPV_TRACE(sort);
+    typedef typename std::decay<decltype(__key(std::declval<const value_type&>()))>::type _Key;
+    typedef std::pair<_Key, size_type> _Entry;
+
+    const size_type __n = size();
+    std::vector<_Entry> __keys;
+    std::vector<size_type> __src;
+    __keys.reserve(__n);
+    __src.reserve(__n);
+    for (size_type __i = 0; __i < __n; ++__i)
+    {
+      if (iList[__i])
+        __keys.emplace_back(__key(*iList[__i]), __i);
+    }
+    std::sort(__keys.begin(), __keys.end(),
+              [&__comp](const _Entry& __x, const _Entry& __y)
+              {
+                if (__comp(__x.first, __y.first))
+                  return true;
+                if (__comp(__y.first, __x.first))
+                  return false;
+                return __x.second < __y.second;
+              });
+    for (auto __i = __keys.begin(); __i != __keys.end(); ++__i)
+      __src.push_back(__i->second);
+    std::vector<_Entry>().swap(__keys);
+    for (size_type __i = 0; __i < __n; ++__i)
+    {
+      if (!iList[__i])
+        __src.push_back(__i);
+    }
+    _M_permute(__src);
+  }
+
+  /**
+   *  @brief  Sorts arithmetic elements with a radix sort.
+   *
+   *  Only for integral and floating point _Tp.  See radix_sort(_KeyFn).
+   */
+  void
+  radix_sort()
+  {
+    radix_sort([](const value_type& __v) { return __v; });
+  }
+
+  /**
+   *  @brief  Sorts the elements with a radix sort on a key.
+   *  @param  __key  Function which returns the key of a value_type, an
+   *                 integral or floating point number.
+   *
+   *  The keys are extracted once into (key, index) pairs which are sorted
+   *  by an LSD radix sort, one pass per key byte (passes where all bytes
+   *  are equal are skipped), in O(n) per pass.  The slots are then moved
+   *  to their places in one pass.  The sort is stable and NULL is last
+   *  element, as for sort().
+   */
+  template<typename _KeyFn>
+  void
+  radix_sort(_KeyFn __key)
+  {
+    _SPV_TRACE(sort);
+    typedef typename std::decay<decltype(__key(std::declval<const value_type&>()))>::type _Key;
+    typedef shared_ptr_vector_radix_key<_Key> _Radix;
+    typedef typename _Radix::type _UKey;
+    typedef std::pair<_UKey, size_type> _Entry;
+    const unsigned __digits = sizeof(_UKey);
+
+    const size_type __n = size();
+    std::vector<_Entry> __a;
+    __a.reserve(__n);
+    std::vector<size_type> __count(__digits * 256);
+    for (size_type __i = 0; __i < __n; ++__i)
+    {
+      if (iList[__i])
+      {
+        const _UKey __k = _Radix::encode(__key(*iList[__i]));
+        __a.emplace_back(__k, __i);
+        for (unsigned __d = 0; __d < __digits; ++__d)
+          ++__count[__d * 256 + ((__k >> (__d * 8)) & 0xff)];
+      }
+    }
+
+    std::vector<_Entry> __b(__a.size());
+    for (unsigned __d = 0; __d < __digits; ++__d)
+    {
+      size_type* __c = &__count[__d * 256];
+      if (*std::max_element(__c, __c + 256) == __a.size())
+        continue;
+      size_type __sum = 0;
+      for (unsigned __j = 0; __j < 256; ++__j)
+      {
+        const size_type __t = __c[__j];
+        __c[__j] = __sum;
+        __sum += __t;
+      }
+      for (auto __i = __a.begin(); __i != __a.end(); ++__i)
+        __b[__c[(__i->first >> (__d * 8)) & 0xff]++] = *__i;
+      __a.swap(__b);
+    }
+    std::vector<_Entry>().swap(__b);
+
+    std::vector<size_type> __src;
+    __src.reserve(__n);
+    for (auto __i = __a.begin(); __i != __a.end(); ++__i)
+      __src.push_back(__i->second);
+    std::vector<_Entry>().swap(__a);
+    for (size_type __i = 0; __i < __n; ++__i)
+    {
+      if (!iList[__i])
+        __src.push_back(__i);
+    }
+    _M_permute(__src);
+  }
+
+  /*
+  template <typename _Cmp>
+  struct ElemCmp
+  {
+    bool operator()(const shared_data_type& lhs, const shared_data_type& rhs) const
+    {
+      return cmp(lhs.get(), rhs.get());
+    }
+  private:
+    _Cmp cmp;
+  }
+  template <typename _Cmp>
+  void
+  sort(_Cmp __c)
+  {
+   std::sort(begin(), end(), ElemCmp<_Cmp>());
+  }
+  */
+
+  /**
+   *  @brief  find the position where __x is.
+   *  @param  __x  A pointer
+   *  @return  iterator where __x is
+   *
+   */
+  iterator
+  find(const data_type& __x)
+  {
+    if (iIndex)
+      return begin() + _M_index_find(__x);
+    return std::find_if(begin(), end(), shared_ptr_data_equal(__x));
+  }
+  const_iterator
+  find(const data_type& __x) const
+  {
+    if (iIndex)
+      return begin() + _M_index_find(__x);
+    return std::find_if(begin(), end(), shared_ptr_data_equal(__x));
+  }
+
+  iterator
+  find_value(const value_type& __x)
+  {
+    if (_S_hashable && iIndex)
+      return begin() + _M_index_find_value(__x);
+    return std::find_if(begin(), end(), shared_ptr_value_equal(__x));
+  }
+  const_iterator
+  find_value(const value_type& __x) const
+  {
+    if (_S_hashable && iIndex)
+      return begin() + _M_index_find_value(__x);
+    return std::find_if(begin(), end(), shared_ptr_value_equal(__x));
+  }
+  iterator
+  find_value(const data_type& __x)
+  {
+    if (__x)
+      return find_value(*__x);
+    else
+      return end();
+  }
+  const_iterator
+  find_value(const data_type& __x) const
+  {
+    if (__x)
+      return find_value(*__x);
+    else
+      return end();
+  }
+
+  /**
+   *  @brief  Turns on the hash index of this shared_ptr_vector.
+   *
+   *  The index maps the pointers, and the hashes of the values if
+   *  std::hash<_Tp> exists, to their positions, so that find() and
+   *  find_value() take O(1).  It is kept up to date in O(1) by push_back,
+   *  emplace_back, pop_back, at(n, x), and insert, emplace and erase at
+   *  the end.  Other modifications (insert or erase in the middle,
+   *  assign, resize, sort, ...) make it stale, and it is rebuilt in O(n)
+   *  by the next lookup.  The index is not copied with the
+   *  shared_ptr_vector; it goes with a move construction, and a move
+   *  assignment leaves the indexes of both sides stale.
+   *
+   *  @Note Changing slots through iterators, or the value of an element
+   *        through its pointer, is not seen by the index; call
+   *        rebuild_index() afterwards.
+   *        A const lookup that rebuilds the index takes a lock, so const
+   *        lookups may run concurrently, as on a published snapshot.
+   */
+  void
+  enable_index()
+  {
+    if (!iIndex)
+      iIndex.reset(new _Index);
+  }
+
+  /**  Turns off the hash index and frees it.  */
+  void
+  disable_index()
+  { iIndex.reset(); }
+
+  /**  Returns true if the hash index is on.  */
+  bool
+  indexed() const
+  { return (bool)iIndex; }
+
+  /**  Makes the next lookup rebuild the hash index.  */
+  void
+  rebuild_index()
+  { _M_index_dirty(); }
+
+  /**
+   *  Returns an estimate of the bytes used by the hash index, 0 if it is
+   *  off.
+   */
+  size_type
+  index_memory() const
+  {
+    if (!iIndex)
+      return 0;
+    // a node holds the next pointer, the cached hash and the entry
+    return sizeof(_Index)
+         + (iIndex->byPtr.bucket_count() + iIndex->byHash.bucket_count()) * sizeof(void*)
+         + iIndex->byPtr.size() * (2 * sizeof(void*) + sizeof(std::pair<const_data_type, size_type>))
+         + iIndex->byHash.size() * (2 * sizeof(void*) + sizeof(std::pair<std::size_t, size_type>));
+  }
+
+  /**
+   *  @brief  Turns on the recycling of elements.
+   *  @param  __high_water  Most elements kept for reuse.
+   *
+   *  An element released by pop_back, erase or clear whose last reference
+   *  was the slot is kept in a free list, up to @a __high_water elements,
+   *  instead of being destroyed.  emplace_back takes an element from the
+   *  free list if there is one and resets it with
+   *  shared_ptr_vector_recycle<_Tp>::reset(element, args...), so neither
+   *  an allocation nor a construction is made.  Calling it again changes
+   *  the high-water mark.
+   *
+   *  @Note The reference count tells whether the slot held the last
+   *        reference, so elements in intrusive_shared_ptr are never
+   *        recycled.  Elements observed through a std::weak_ptr must not
+   *        be recycled, since the observer may see them reused.
+   */
+  void
+  enable_recycling(size_type __high_water = 1024)
+  {
+    if (!iRecycle)
+      iRecycle.reset(new _Recycle);
+    iRecycle->high_water = __high_water;
+    _M_trim_recycled(__high_water);
+  }
+
+  /**  Turns off the recycling of elements and frees the free list.  */
+  void
+  disable_recycling()
+  {
+    _M_trim_recycled(0);
+    iRecycle.reset();
+  }
+
+  /**  Returns true if elements are recycled.  */
+  bool
+  recycling() const
+  { return (bool)iRecycle; }
+
+  /**  Returns the number of elements kept for reuse.  */
+  size_type
+  recycled() const
+  { return iRecycle ? iRecycle->free.size() : 0; }
+
+  /**  Returns the number of emplace_back calls which reused an element.  */
+  size_type
+  recycle_hits() const
+  { return iRecycle ? iRecycle->hits : 0; }
+
+  /**  Returns the number of emplace_back calls which found the free list empty.  */
+  size_type
+  recycle_misses() const
+  { return iRecycle ? iRecycle->misses : 0; }
+
+public:
+  // statistics
+  /**
+   *  @brief  Returns the counters of this shared_ptr_vector.
+   *
+   *  The event counters count since construction or reset_stats(), and
+   *  stay 0 unless SHARED_PTR_VECTOR_STATS is defined.  bytes_reserved
+   *  and bytes_used are those of the slots now.  See
+   *  shared_ptr_vector_stats::global() for all the shared_ptr_vectors.
+   */
+  shared_ptr_vector_stats
+  stats() const
+  {
+    shared_ptr_vector_stats __s = iStats;
+    __s.bytes_reserved = capacity() * sizeof(shared_data_type);
+    __s.bytes_used = size() * sizeof(shared_data_type);
+    return __s;
+  }
+
+  /**  Sets the event counters of this shared_ptr_vector to 0.  */
+  void
+  reset_stats()
+  { iStats = shared_ptr_vector_stats(); }
+
+  /**
+   *  @brief  find iterator where __c is true.
+   *  @param  __c  A compare object - compare values
+   *  @return  iterator where __c is true.
+   *
+   */
+  template <typename _Cmp>
+  iterator
+  find_if_value(const _Cmp& __c)
+  {
+    for (auto i = begin(); i != end(); ++i)
+    {
+      if (*i && __c(**i))
+      {
+        return i;
+      }
+    }
+    return end();
+  }
+
+  /**
+   *  @brief  find the position where __x is, in parallel.
+   *  @param  __par  The threads to use.
+   *  @param  __x  A pointer
+   *  @return  iterator where __x is first
+   *
+   *  Each thread searches one chunk.  The result is the lowest matching
+   *  position, the same as of the serial version.
+   */
+  iterator
+  find(const shared_ptr_vector_parallel& __par, const data_type& __x)
+  {
+    return begin() + _M_find_if(__par, shared_ptr_data_equal(__x));
+  }
+  const_iterator
+  find(const shared_ptr_vector_parallel& __par, const data_type& __x) const
+  {
+    return begin() + _M_find_if(__par, shared_ptr_data_equal(__x));
+  }
+
+  iterator
+  find_value(const shared_ptr_vector_parallel& __par, const value_type& __x)
+  {
+    return begin() + _M_find_if(__par, shared_ptr_value_equal(__x));
+  }
+  const_iterator
+  find_value(const shared_ptr_vector_parallel& __par, const value_type& __x) const
+  {
+    return begin() + _M_find_if(__par, shared_ptr_value_equal(__x));
+  }
+  iterator
+  find_value(const shared_ptr_vector_parallel& __par, const data_type& __x)
+  {
+    if (__x)
+      return begin() + _M_find_if(__par, shared_ptr_value_equal(*__x));
+    else
+      return end();
+  }
+  const_iterator
+  find_value(const shared_ptr_vector_parallel& __par, const data_type& __x) const
+  {
+    if (__x)
+      return begin() + _M_find_if(__par, shared_ptr_value_equal(*__x));
+    else
+      return end();
+  }
+
+  /**
+   *  @brief  find iterator where __c is true, in parallel.
+   *  @param  __par  The threads to use.
+   *  @param  __c  A compare object - compare values
+   *  @return  iterator where __c is first true.
+   *
+   *  @a __c is called from several threads at once.
+   */
+  template <typename _Cmp>
+  iterator
+  find_if_value(const shared_ptr_vector_parallel& __par, const _Cmp& __c)
+  {
+    return begin() + _M_find_if(__par, [&__c](const shared_data_type& __p) { return __p && __c(*__p); });
+  }
+
+private:
+  // number of slots in [__first, __last) which hold an element
+  template<typename _Iter>
+  static size_type
+  _S_held(_Iter __first, _Iter __last)
+  { return std::count_if(__first, __last, [](const shared_data_type& __p) { return bool(__p); }); }
+
+  // true if a slot made from __p allocates a reference count
+  static bool
+  _S_adopts(const data_type& __p)
+  { return __p && !std::is_same<_Policy, intrusive_ptr_policy<_Tp> >::value; }
+
+#ifdef SHARED_PTR_VECTOR_STATS
+  void
+  _M_stats(shared_ptr_vector_counter __c, std::uint64_t __n)
+  {
+    iStats[__c] += __n;
+    shared_ptr_vector_stats::add_global(__c, __n);
+  }
+#endif
+
+  /**
+   *  The spine of a shared_ptr_vector.  Every change of the spine, and
+   *  every copy or release of a slot in it, goes through the members
+   *  declared here, which count them into the counters of the owning
+   *  shared_ptr_vector; so does a spine built aside to replace it.  They
+   *  hide the members of _spine_type of the same name, so that no
+   *  uncounted overload is picked by mistake.
+   */
+  class _Slots : public _spine_type
+  {
+  public:
+    explicit
+    _Slots(shared_ptr_vector_stats& __s, const allocator_type& __a = allocator_type())
+    : _spine_type(__a)
+    , iCounters(&__s)
+    { }
+
+    _Slots(shared_ptr_vector_stats& __s, size_type __n, const allocator_type& __a)
+    : _spine_type(__n, __a)
+    , iCounters(&__s)
+    {
+      _SPV_STATS_NEW();
+    }
+
+    _Slots(shared_ptr_vector_stats& __s, size_type __n, shared_data_type&& __x, const allocator_type& __a)
+    : _spine_type(__n, __x, __a)
+    , iCounters(&__s)
+    {
+      _SPV_STATS_NEW();
+      _SPV_STATS_FILL(__n, __x);
+    }
+
+    _Slots(shared_ptr_vector_stats& __s, const _Slots& __x)
+    : _spine_type(__x)
+    , iCounters(&__s)
+    {
+      _SPV_STATS_NEW();
+      _SPV_STATS(refcount_increments, _S_held(this->begin(), this->end()));
+    }
+
+    _Slots(shared_ptr_vector_stats& __s, const _Slots& __x, const allocator_type& __a)
+    : _spine_type(__x, __a)
+    , iCounters(&__s)
+    {
+      _SPV_STATS_NEW();
+      _SPV_STATS(refcount_increments, _S_held(this->begin(), this->end()));
+    }
+
+    // the spine of __x is taken, so nothing is allocated or copied
+    _Slots(shared_ptr_vector_stats& __s, _Slots&& __x)
+    : _spine_type(std::move(__x))
+    , iCounters(&__s)
+    { }
+
+    _Slots(shared_ptr_vector_stats& __s, _Slots&& __x, const allocator_type& __a)
+    : _spine_type(std::move(__x), __a)
+    , iCounters(&__s)
+    {
+      // the slots were moved to a new spine if __x kept its own
+      if (__x.capacity() != 0)
+      {
+        _SPV_STATS_NEW();
+      }
+    }
+
+    _Slots(const _Slots&) = delete;
+
+    ~_Slots()
+    {
+      _SPV_STATS(refcount_decrements, _S_held(this->begin(), this->end()));
+      _SPV_STATS(bytes_reserved, 0 - std::uint64_t(this->capacity() * sizeof(shared_data_type)));
+      _SPV_STATS(bytes_used, 0 - std::uint64_t(this->size() * sizeof(shared_data_type)));
+    }
+
+    _Slots&
+    operator=(const _Slots& __x)
+    {
+      if (&__x != this)
+      {
+        _SPV_STATS_SPINE(this);
+        _SPV_STATS(refcount_decrements, _S_held(this->begin(), this->end()));
+        _SPV_STATS(refcount_increments, _S_held(__x.begin(), __x.end()));
+        _spine_type::operator=(__x);
+      }
+      return *this;
+    }
+
+    _Slots&
+    operator=(_Slots&& __x)
+    {
+      _SPV_STATS_MOVE(this);
+      _SPV_STATS_MOVE(&__x);
+      _SPV_STATS(refcount_decrements, _S_held(this->begin(), this->end()));
+      _spine_type::operator=(std::move(__x));
+      return *this;
+    }
+
+    void
+    assign(size_type __n, shared_data_type&& __x)
+    {
+      _SPV_STATS_SPINE(this);
+      _SPV_STATS(refcount_decrements, _S_held(this->begin(), this->end()));
+      _SPV_STATS_FILL(__n, __x);
+      _spine_type::assign(__n, __x);
+    }
+
+    void
+    resize(size_type __n)
+    {
+      _SPV_STATS_SPINE(this);
+      _SPV_STATS(refcount_decrements, __n < this->size() ? _S_held(this->begin() + __n, this->end()) : 0);
+      _spine_type::resize(__n);
+    }
+
+    void
+    resize(size_type __n, shared_data_type&& __x)
+    {
+      _SPV_STATS_SPINE(this);
+      _SPV_STATS(refcount_decrements, __n < this->size() ? _S_held(this->begin() + __n, this->end()) : 0);
+      _SPV_STATS_FILL(__n > this->size() ? __n - this->size() : 0, __x);
+      _spine_type::resize(__n, __x);
+    }
+
+    void
+    reserve(size_type __n)
+    {
+      _SPV_STATS_SPINE(this);
+      _spine_type::reserve(__n);
+    }
+
+    void
+    shrink_to_fit()
+    {
+      _SPV_STATS_SPINE(this);
+      _spine_type::shrink_to_fit();
+    }
+
+    void
+    push_back(shared_data_type&& __x)
+    {
+      _SPV_STATS_SPINE(this);
+      _spine_type::push_back(std::move(__x));
+    }
+
+    void
+    pop_back()
+    {
+      _SPV_STATS_SPINE(this);
+      _SPV_STATS(refcount_decrements, bool(this->back()));
+      _spine_type::pop_back();
+    }
+
+    iterator
+    insert(const_iterator __position, shared_data_type&& __x)
+    {
+      _SPV_STATS_SPINE(this);
+      return _spine_type::insert(__position, std::move(__x));
+    }
+
+    iterator
+    insert(const_iterator __position, size_type __n, shared_data_type&& __x)
+    {
+      _SPV_STATS_SPINE(this);
+      _SPV_STATS_FILL(__n, __x);
+      return _spine_type::insert(__position, __n, __x);
+    }
+
+    iterator
+    erase(const_iterator __position)
+    {
+      _SPV_STATS_SPINE(this);
+      _SPV_STATS(refcount_decrements, __position != this->cend() && bool(*__position));
+      return _spine_type::erase(__position);
+    }
+
+    iterator
+    erase(const_iterator __first, const_iterator __last)
+    {
+      _SPV_STATS_SPINE(this);
+      _SPV_STATS(refcount_decrements, _S_held(__first, __last));
+      return _spine_type::erase(__first, __last);
+    }
+
+    // releases all the slots, handing them to __r if it can queue them
+    void
+    clear(shared_ptr_reclaimer* __r = nullptr) noexcept
+    {
+      _SPV_STATS_SPINE(this);
+      _SPV_STATS(refcount_decrements, _S_held(this->begin(), this->end()));
+      if (!__r || this->empty() || !__r->retire(std::nothrow, std::move(static_cast<_spine_type&>(*this))))
+        _spine_type::clear();
+    }
+
+    // sets __slot, a slot of this spine, to __x
+    void
+    replace(shared_data_type& __slot, shared_data_type&& __x)
+    {
+      _SPV_STATS(refcount_decrements, bool(__slot));
+      __slot = std::move(__x);
+    }
+
+    // both spines stay live and keep their counters
+    void
+    swap(_Slots& __x)
+    { _spine_type::swap(__x); }
+
+    // the slots move in and out, so no reference count is touched
+    void
+    swap(_spine_type& __x)
+    {
+      _SPV_STATS_MOVE(this);
+      _spine_type::swap(__x);
+    }
+
+    // frees the spine without releasing the slots (see release_all())
+    void
+    forget() noexcept
+    {
+      _SPV_STATS_MOVE(this);
+      _S_forget(static_cast<_spine_type&>(*this));
+    }
+
+  private:
+#ifdef SHARED_PTR_VECTOR_STATS
+    void
+    _M_stats(shared_ptr_vector_counter __c, std::uint64_t __n)
+    {
+      (*iCounters)[__c] += __n;
+      shared_ptr_vector_stats::add_global(__c, __n);
+    }
+
+    void
+    _M_stats_fill(size_type __n, const shared_data_type& __x)
+    {
+      if (!__x)
+        return;
+      _M_stats(shared_ptr_vector_counter::refcount_increments, __n);
+      _M_stats(shared_ptr_vector_counter::refcount_decrements, 1);
+    }
+
+    /**
+     *  Counts the changes of a spine from the construction of the scope
+     *  to its destruction.
+     */
+    struct _StatsSpine
+    {
+      _StatsSpine(_Slots* __s, bool __realloc)
+      : iSpine(__s)
+      , iSize(__s->size())
+      , iCapacity(__s->capacity())
+      , iRealloc(__realloc)
+      { }
+
+      _StatsSpine(_Slots* __s, size_type __size, size_type __capacity)
+      : iSpine(__s)
+      , iSize(__size)
+      , iCapacity(__capacity)
+      , iRealloc(true)
+      { }
+
+      ~_StatsSpine()
+      {
+        const size_type __cap = iSpine->capacity();
+        if (iRealloc && __cap != iCapacity && __cap != 0)
+          iSpine->_M_stats(shared_ptr_vector_counter::spine_reallocations, 1);
+        shared_ptr_vector_stats::add_global(shared_ptr_vector_counter::bytes_reserved,
+                                            std::uint64_t(__cap - iCapacity) * sizeof(shared_data_type));
+        shared_ptr_vector_stats::add_global(shared_ptr_vector_counter::bytes_used,
+                                            std::uint64_t(iSpine->size() - iSize) * sizeof(shared_data_type));
+      }
+
+      _StatsSpine(const _StatsSpine&) = delete;
+      _StatsSpine& operator=(const _StatsSpine&) = delete;
+
+      _Slots*   iSpine;
+      size_type iSize;
+      size_type iCapacity;
+      bool      iRealloc;
+    };
+#endif
+
+    shared_ptr_vector_stats* iCounters;
+  };
+
+  template<typename... _Args>
+  shared_data_type
+  _M_make(_Args&&... __args)
+  {
+    _SPV_STATS(element_allocations, 1);
+    if (iPool)
+      return _Policy::allocate(shared_ptr_pool_allocator<_Tp>(iPool), std::forward<_Args>(__args)...);
+    return _Policy::make(std::forward<_Args>(__args)...);
+  }
+
+  template<typename _ElemAlloc, typename... _Args>
+  shared_data_type
+  _M_allocate(const _ElemAlloc& __a, _Args&&... __args)
+  {
+    _SPV_STATS(element_allocations, 1);
+    return _Policy::allocate(__a, std::forward<_Args>(__args)...);
+  }
+
+  // a slot for an element of a range: pointer, shared_data_type or value
+  shared_data_type
+  _M_slot(const data_type& __p)
+  {
+    _SPV_STATS(control_block_allocations, _S_adopts(__p));
+    return shared_data_type(__p);
+  }
+
+  shared_data_type
+  _M_slot(std::nullptr_t)
+  { return shared_data_type(); }
+
+  shared_data_type
+  _M_slot(const shared_data_type& __p)
+  {
+    _SPV_STATS(refcount_increments, bool(__p));
+    return __p;
+  }
+
+  shared_data_type&&
+  _M_slot(shared_data_type&& __p)
+  { return std::move(__p); }
+
+  shared_data_type
+  _M_slot(const value_type& __x)
+  { return _M_make(__x); }
+
+  template<typename _ForwardIterator>
+  iterator
+  _M_range_insert(size_type __off, _ForwardIterator __first, _ForwardIterator __last, std::forward_iterator_tag)
+  {
+    const size_type __n = std::distance(__first, __last);
+    // a gap of NULL slots, the tail moved behind it once, then filled
+    iList.insert(iList.begin() + __off, __n, shared_data_type());
+    size_type __i = __off;
+    try
+    {
+      for ( ; __first != __last; ++__first, ++__i)
+        iList[__i] = _M_slot(*__first);
+    }
+    catch (...)
+    {
+      iList.erase(iList.begin() + __off, iList.begin() + __off + __n);
+      throw;
+    }
+    return begin() + __off;
+  }
+
+  template<typename _InputIterator>
+  iterator
+  _M_range_insert(size_type __off, _InputIterator __first, _InputIterator __last, std::input_iterator_tag)
   {
-    shared_ptr_value_equal(const value_type& __x)
-    : iData(__x)
-    { }
-
-    bool operator()(const shared_data_type& val) const
+    // single pass: appended, then rotated into place
+    const size_type __old = size();
+    try
     {
-      if (val.get())
-        return *val.get() == iData;
-      else
-        return false;
+      for ( ; __first != __last; ++__first)
+        iList.push_back(_M_slot(*__first));
     }
+    catch (...)
+    {
+      iList.resize(__old);
+      throw;
+    }
+    std::rotate(iList.begin() + __off, iList.begin() + __old, iList.end());
+    return begin() + __off;
+  }
 
-  private:
-    const value_type iData;
-  };
   /**
-   *  NULL is last element
+   *  Free list of recycled elements.
    */
-  struct shared_ptr_value_less
+  struct _Recycle
   {
-    bool operator()(const shared_data_type& lhs, const shared_data_type& rhs) const
+    std::vector<shared_data_type> free;
+    size_type                     high_water = 0;
+    size_type                     hits = 0;
+    size_type                     misses = 0;
+  };
+
+  static constexpr char _S_serial_magic[4] = { 'S', 'P', 'V', '1' };
+  // slots reserved ahead on the count of an input, which may be bogus
+  static constexpr size_type _S_serial_reserve = 4096;
+
+  // integers as LEB128
+  template<typename _Writer>
+  static void
+  _S_put(_Writer& __w, std::uint64_t __x)
+  {
+    char __b[10];
+    int __n = 0;
+    do
     {
-      if (lhs.get() && rhs.get())
-        return *lhs.get() < *rhs.get();
-      else if (lhs.get())
-        return true;
-      else
-        return false;
+      __b[__n] = char(__x & 0x7f);
+      __x >>= 7;
+      if (__x)
+        __b[__n] |= char(0x80);
+      ++__n;
+    } while (__x);
+    __w.write(__b, __n);
+  }
+
+  template<typename _Reader>
+  static std::uint64_t
+  _S_get(_Reader& __r)
+  {
+    std::uint64_t __x = 0;
+    for (unsigned __s = 0; __s < 64; __s += 7)
+    {
+      char __c;
+      _S_get(__r, &__c, 1);
+      __x |= std::uint64_t(__c & 0x7f) << __s;
+      if (!(__c & 0x80))
+        return __x;
     }
-  };
+    throw std::runtime_error("shared_ptr_vector::deserialize: bad integer");
+  }
 
-  /**
-   *  @brief  output the elements of the shared_ptr_vector to ostream.
-   *  @param  os   A output stream.
-   *  @param  __x  A shared_ptr_vector.
-   *  @return  os(input ostreeam)
-   *
-   *  This outpus the element of the shared_ptr_vector to ostream.
-   *  The elements must have << operation.
-   */
+  template<typename _Reader>
+  static void
+  _S_get(_Reader& __r, char* __p, std::size_t __n)
+  {
+    __r.read(__p, __n);
+    _S_check(__r);
+  }
+
+  // a std::istream tells a short read by its state; other readers throw
+  template<typename _Reader>
+  static void
+  _S_check(_Reader& __r)
+  {
+    if constexpr (std::is_base_of<std::istream, _Reader>::value)
+      if (!__r)
+        throw std::runtime_error("shared_ptr_vector::deserialize: input cut short");
+  }
+
+  // true if the slot holds the only reference; false if it cannot tell
+  template<typename _Ptr>
+  static auto
+  _S_unique(const _Ptr& __p, int) -> decltype(__p.use_count() == 1)
+  { return __p.use_count() == 1; }
+
+  template<typename _Ptr>
+  static bool
+  _S_unique(const _Ptr&, long)
+  { return false; }
+
+  // true if every slot holds the only reference to a block of the pool
+  bool
+  _M_unique_pooled() const
+  {
+    for (auto __i = iList.begin(); __i != iList.end(); ++__i)
+      if (!_S_unique(*__i, 0))
+        return false;
+    return iPool->owns(iList.begin(), iList.end());
+  }
+
+  // true if shared_ptr_vector_recycle<_Tp>::reset takes _Args
+  template<typename... _Args>
+  static auto
+  _S_resettable(int) -> decltype(shared_ptr_vector_recycle<_Tp>::reset(std::declval<_Tp&>(), std::declval<_Args>()...), std::true_type());
+
+  template<typename... _Args>
+  static std::false_type
+  _S_resettable(long);
+
+  // moves the element of __slot to the free list if it may be reused
   void
-  sort()
+  _M_recycle(shared_data_type& __slot)
   {
-   std::sort(begin(), end(), shared_ptr_value_less());
+    if (iRecycle && iRecycle->free.size() < iRecycle->high_water && __slot && _S_unique(__slot, 0))
+      iRecycle->free.push_back(std::move(__slot));
   }
 
-  /*
-  template <typename _Cmp>
-  struct ElemCmp
+  // queue entries allocated ahead by set_reclaimer()
+  static constexpr std::size_t _S_retire_reserve = 16;
+
+  // moves a released slot to the reclaimer; it stays if there is none
+  void
+  _M_retire(shared_data_type& __slot) noexcept
   {
-    bool operator()(const shared_data_type& lhs, const shared_data_type& rhs) const
+    if (iReclaimer && __slot)
     {
-      return cmp(lhs.get(), rhs.get());
+      _SPV_STATS(refcount_decrements, 1);
+      iRetired->retire(*iReclaimer, std::move(__slot));
     }
-  private:
-    _Cmp cmp;
   }
-  template <typename _Cmp>
+
+  // releases the elements of the free list beyond the first __keep
   void
-  sort(_Cmp __c)
+  _M_trim_recycled(size_type __keep)
   {
-   std::sort(begin(), end(), ElemCmp<_Cmp>());
+    if (iRecycle && iRecycle->free.size() > __keep)
+    {
+      _SPV_STATS(refcount_decrements, iRecycle->free.size() - __keep);
+      iRecycle->free.resize(__keep);
+    }
   }
-  */
+
+  static constexpr bool _S_hashable = std::is_default_constructible<std::hash<_Tp> >::value;
 
   /**
-   *  @brief  find the position where __x is.
-   *  @param  __x  A pointer
-   *  @return  iterator where __x is
-   *
+   *  Hash index: positions of the pointers, and of the values by their
+   *  hashes.  Both are multimaps since slots may share elements or equal
+   *  values.
    */
-  iterator
-  find(const data_type& __x)
+  struct _Index
   {
-    return std::find_if(begin(), end(), shared_ptr_data_equal(__x));
+    std::unordered_multimap<const_data_type, size_type> byPtr;
+    std::unordered_multimap<std::size_t, size_type>     byHash;
+    std::atomic<bool>                                   dirty{true};
+    std::mutex                                          rebuild;  // of concurrent const lookups
+  };
+
+  static std::size_t
+  _S_hash(const value_type& __x)
+  {
+    if constexpr (_S_hashable)
+      return std::hash<_Tp>()(__x);
+    else
+      return 0;
   }
-  const_iterator
-  find(const data_type& __x) const
+
+  template<typename _Map, typename _Key>
+  static void
+  _S_erase_entry(_Map& __m, const _Key& __k, size_type __pos)
   {
-    return std::find_if(begin(), end(), shared_ptr_data_equal(__x));
+    auto __r = __m.equal_range(__k);
+    for (auto __i = __r.first; __i != __r.second; ++__i)
+    {
+      if (__i->second == __pos)
+      {
+        __m.erase(__i);
+        return;
+      }
+    }
   }
 
-  iterator
-  find_value(const value_type& __x)
+  void
+  _M_index_dirty()
   {
-    return std::find_if(begin(), end(), shared_ptr_value_equal(__x));
+    if (iIndex && !iIndex->dirty.load(std::memory_order_relaxed))
+    {
+      iIndex->byPtr.clear();
+      iIndex->byHash.clear();
+      iIndex->dirty.store(true, std::memory_order_relaxed);
+    }
   }
-  const_iterator
-  find_value(const value_type& __x) const
+
+  void
+  _M_index_add(size_type __pos)
   {
-    return std::find_if(begin(), end(), shared_ptr_value_equal(__x));
+    if (!iIndex || iIndex->dirty.load(std::memory_order_relaxed))
+      return;
+    const_data_type __p = iList[__pos].get();
+    iIndex->byPtr.emplace(__p, __pos);
+    if (_S_hashable && __p)
+      iIndex->byHash.emplace(_S_hash(*__p), __pos);
   }
-  iterator
-  find_value(const data_type& __x)
+
+  void
+  _M_index_remove(size_type __pos)
   {
-    if (__x)
-      return std::find_if(begin(), end(), shared_ptr_value_equal(*__x));
+    if (!iIndex || iIndex->dirty.load(std::memory_order_relaxed))
+      return;
+    const_data_type __p = iList[__pos].get();
+    _S_erase_entry(iIndex->byPtr, __p, __pos);
+    if (_S_hashable && __p)
+      _S_erase_entry(iIndex->byHash, _S_hash(*__p), __pos);
+  }
+
+  // after a slot was inserted at __pos
+  void
+  _M_index_insert(size_type __pos)
+  {
+    if (__pos + 1 == size())
+      _M_index_add(__pos);
     else
-      return end();
+      _M_index_dirty();
   }
-  const_iterator
-  find_value(const data_type& __x) const
+
+  // before the slot at __pos is erased
+  void
+  _M_index_erase(size_type __pos)
   {
-    if (__x)
-      return std::find_if(begin(), end(), shared_ptr_value_equal(*__x));
+    if (__pos + 1 == size())
+      _M_index_remove(__pos);
     else
-      return end();
+      _M_index_dirty();
   }
 
-  /**
-   *  @brief  find iterator where __c is true.
-   *  @param  __c  A compare object - compare values
-   *  @return  iterator where __c is true.
-   *
-   */
-  template <typename _Cmp>
-  iterator
-  find_if_value(const _Cmp& __c)
+  // rebuilt at most once by concurrent const lookups, which see it
+  // complete through the release store of dirty
+  _Index&
+  _M_index() const
   {
-    for (auto i = begin(); i != end(); ++i)
+    _Index& __x = *iIndex;
+    if (!__x.dirty.load(std::memory_order_acquire))
+      return __x;
+    std::lock_guard<std::mutex> __lock(__x.rebuild);
+    if (__x.dirty.load(std::memory_order_relaxed))
     {
-      if (*i && __c(**i))
+      // left by a rebuild that threw
+      __x.byPtr.clear();
+      __x.byHash.clear();
+      __x.byPtr.reserve(size());
+      if (_S_hashable)
+        __x.byHash.reserve(size());
+      for (size_type __i = 0; __i < size(); ++__i)
       {
-        return i;
+        const_data_type __p = iList[__i].get();
+        __x.byPtr.emplace(__p, __i);
+        if (_S_hashable && __p)
+          __x.byHash.emplace(_S_hash(*__p), __i);
       }
+      __x.dirty.store(false, std::memory_order_release);
     }
-    return end();
+    return __x;
   }
 
-private:
+  // lowest position of __x, or size()
+  size_type
+  _M_index_find(const_data_type __x) const
+  {
+    size_type __pos = size();
+    auto __r = _M_index().byPtr.equal_range(__x);
+    for (auto __i = __r.first; __i != __r.second; ++__i)
+      __pos = std::min(__pos, __i->second);
+    return __pos;
+  }
+
+  // lowest position of a value equal to __x, or size()
+  size_type
+  _M_index_find_value(const value_type& __x) const
+  {
+    size_type __pos = size();
+    auto __r = _M_index().byHash.equal_range(_S_hash(__x));
+    for (auto __i = __r.first; __i != __r.second; ++__i)
+    {
+      if (__i->second < __pos && *iList[__i->second] == __x)
+        __pos = __i->second;
+    }
+    return __pos;
+  }
+
+  /**
+   *  Returns the lowest position where __pred is true, or size().  Each
+   *  thread searches its chunk in blocks and gives up as soon as a lower
+   *  position has been found by another thread.
+   */
+  template<typename _Pred>
+  size_type
+  _M_find_if(const shared_ptr_vector_parallel& __par, const _Pred& __pred) const
+  {
+    const size_type __n = size();
+    const unsigned __k = __par.split(__n);
+    if (__k <= 1)
+      return std::find_if(iList.begin(), iList.end(), __pred) - iList.begin();
+
+    const size_type __block = 1024;
+    std::atomic<size_type> __found(__n);
+    const shared_data_type* __a = iList.data();
+    shared_ptr_vector_parallel::run(__k, [&](unsigned __i)
+                                    {
+                                      const size_type __f = __n * __i / __k;
+                                      const size_type __l = __n * (__i + 1) / __k;
+                                      for (size_type __b = __f; __b < __l; __b += __block)
+                                      {
+                                        if (__found.load(std::memory_order_relaxed) < __b)
+                                          return;
+                                        const size_type __e = std::min(__b + __block, __l);
+                                        for (size_type __j = __b; __j < __e; ++__j)
+                                        {
+                                          if (__pred(__a[__j]))
+                                          {
+                                            size_type __cur = __found.load(std::memory_order_relaxed);
+                                            while (__j < __cur && !__found.compare_exchange_weak(__cur, __j))
+                                              ;
+                                            return;
+                                          }
+                                        }
+                                      }
+                                    });
+    return __found.load();
+  }
+
+  /**
+   *  Moves the slot at __src[i] to i for every i.  The slots are gathered
+   *  into a new spine, which is written in order, and the old one is
+   *  dropped; this is much faster than following the cycles in place.
+   */
+  void
+  _M_permute(const std::vector<size_type>& __src)
+  {
+    _Slots __tmp(iStats, iList.get_allocator());
+    __tmp.reserve(__src.size());
+    for (auto __i = __src.begin(); __i != __src.end(); ++__i)
+      __tmp.push_back(std::move(iList[*__i]));
+    iList.swap(__tmp);
+    _M_index_dirty();
+  }
+
+  /**
+   *  Empties __v and frees its storage without destroying the slots.
+   */
+  static void
+  _S_forget(shared_ptr_spine<shared_data_type, allocator_type>& __v)
+  {
+    __v.forget();
+  }
+
+  static void
+  _S_forget(_vector_type& __v)
+  {
+    union _Husk
+    {
+      _Husk() { }
+      ~_Husk() { }
+      _vector_type v;
+    } __h;
+    ::new (&__h.v) _vector_type(std::move(__v));
+    if (__h.v.capacity())
+    {
+      allocator_type __a(__h.v.get_allocator());
+      std::allocator_traits<allocator_type>::deallocate(__a, __h.v.data(), __h.v.capacity());
+    }
+  }
+
+  /**
+   * event counters of this shared_ptr_vector, also there when they are
+   * not counted so that the layout does not depend on the macro; before
+   * iList, which counts into them from its construction
+   */
+  shared_ptr_vector_stats iStats;
+
   /**
    * vector which contains shared_ptr
    */
-  _vector_type iList;
+  _Slots iList;
+
+  /**
+   * pool of the elements, NULL if not used
+   */
+  shared_ptr_pool* iPool = nullptr;
+
+  /**
+   * reclaimer of released slots, NULL if not used
+   */
+  shared_ptr_reclaimer* iReclaimer = nullptr;
+
+  /**
+   * queue entries for the slots given to iReclaimer, NULL if not used
+   */
+  shared_ptr_reclaimer_cache<shared_data_type>* iRetired = nullptr;
+
+  /**
+   * hash index, NULL if not used
+   */
+  std::unique_ptr<_Index> iIndex;
+
+  /**
+   * free list of recycled elements, NULL if not used
+   */
+  std::unique_ptr<_Recycle> iRecycle;
 };
 
+/**
+ *  A shared_ptr_vector with non-atomic reference counts.
+ *  See local_ptr_policy.
+ */
+template<typename _Tp, typename _Alloc = std::allocator<local_shared_ptr<_Tp> > >
+using local_shared_ptr_vector = shared_ptr_vector<_Tp, _Alloc, local_ptr_policy<_Tp> >;
+
 #if __cpp_deduction_guides >= 201606
 /*
 template<typename _InputIterator, typename _ValT
@@ -1151,9 +3444,9 @@ shared_ptr_vector(_InputIterator, _InputIterator, _Allocator = _Allocator())
 *  shared_ptr_vectors.  shared_ptr_vectors are considered equivalent if their sizes are equal,
 *  and if corresponding elements compare equal.
 */
-template<typename _Tp, typename _Alloc>
+template<typename _Tp, typename _Alloc, typename _Policy>
 inline bool
-operator==(const shared_ptr_vector<_Tp, _Alloc>& __x, const shared_ptr_vector<_Tp, _Alloc>& __y)
+operator==(const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x, const shared_ptr_vector<_Tp, _Alloc, _Policy>& __y)
 {
 //return (__x.size() == __y.size() && std::equal(__x.begin(), __x.end(), __y.begin()));
   if (__x.size() != __y.size())
@@ -1180,9 +3473,9 @@ operator==(const shared_ptr_vector<_Tp, _Alloc>& __x, const shared_ptr_vector<_T
 *
 *  See std::lexicographical_compare() for how the determination is made.
 */
-template<typename _Tp, typename _Alloc>
+template<typename _Tp, typename _Alloc, typename _Policy>
 inline bool
-operator<(const shared_ptr_vector<_Tp, _Alloc>& __x, const shared_ptr_vector<_Tp, _Alloc>& __y)
+operator<(const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x, const shared_ptr_vector<_Tp, _Alloc, _Policy>& __y)
 {
 //return std::lexicographical_compare(__x.begin(), __x.end(), __y.begin(), __y.end());
   auto xe = __x.end();
@@ -1204,60 +3497,188 @@ operator<(const shared_ptr_vector<_Tp, _Alloc>& __x, const shared_ptr_vector<_Tp
 }
 
 /// Based on operator==
-template<typename _Tp, typename _Alloc>
+template<typename _Tp, typename _Alloc, typename _Policy>
 inline bool
-operator!=(const shared_ptr_vector<_Tp, _Alloc>& __x, const shared_ptr_vector<_Tp, _Alloc>& __y)
+operator!=(const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x, const shared_ptr_vector<_Tp, _Alloc, _Policy>& __y)
 { return !(__x == __y); }
 
 /// Based on operator<
-template<typename _Tp, typename _Alloc>
+template<typename _Tp, typename _Alloc, typename _Policy>
 inline bool
-operator>(const shared_ptr_vector<_Tp, _Alloc>& __x, const shared_ptr_vector<_Tp, _Alloc>& __y)
+operator>(const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x, const shared_ptr_vector<_Tp, _Alloc, _Policy>& __y)
 { return __y < __x; }
 
 /// Based on operator<
-template<typename _Tp, typename _Alloc>
+template<typename _Tp, typename _Alloc, typename _Policy>
 inline bool
-operator<=(const shared_ptr_vector<_Tp, _Alloc>& __x, const shared_ptr_vector<_Tp, _Alloc>& __y)
+operator<=(const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x, const shared_ptr_vector<_Tp, _Alloc, _Policy>& __y)
 { return !(__y < __x); }
 
 /// Based on operator<
-template<typename _Tp, typename _Alloc>
+template<typename _Tp, typename _Alloc, typename _Policy>
 inline bool
-operator>=(const shared_ptr_vector<_Tp, _Alloc>& __x, const shared_ptr_vector<_Tp, _Alloc>& __y)
+operator>=(const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x, const shared_ptr_vector<_Tp, _Alloc, _Policy>& __y)
 { return !(__x < __y); }
 
 /// See std::shared_ptr_vector::swap().
-template<typename _Tp, typename _Alloc>
+template<typename _Tp, typename _Alloc, typename _Policy>
 inline void
-swap(shared_ptr_vector<_Tp, _Alloc>& __x, shared_ptr_vector<_Tp, _Alloc>& __y)
+swap(shared_ptr_vector<_Tp, _Alloc, _Policy>& __x, shared_ptr_vector<_Tp, _Alloc, _Policy>& __y)
 //_GLIBCXX_NOEXCEPT_IF(noexcept(__x.swap(__y)))
 { __x.swap(__y); }
 
 
+/**
+*  @brief  Returns at most how many chars format_to writes.
+*  @param  __x  A shared_ptr_vector of a type with shared_ptr_vector_format.
+*  @return  An upper bound, exact for integers.
+*/
+template <typename _Tp, typename _Alloc, typename _Policy>
+std::size_t
+formatted_size(const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x)
+{
+  static_assert(shared_ptr_vector_formattable<_Tp>::value, "shared_ptr_vector_format<_Tp> is not specialized");
+  std::size_t __n = 3; // "[ " and "]"
+  for (auto i = __x.begin(); i != __x.end(); ++i)
+    __n += (*i ? shared_ptr_vector_format<_Tp>::size(**i) : 4) + 1;
+  return __n;
+}
+
+/**
+*  @brief  Formats the elements of the shared_ptr_vector in chunks.
+*  @param  __x  A shared_ptr_vector.
+*  @param  __sink  Called as __sink(const char*, std::size_t) for each chunk.
+*
+*  The text is that of to_string().  It is built in a buffer on the stack
+*  and handed to __sink each time the buffer is full, so that it is never
+*  held at once.  Elements without shared_ptr_vector_format are written
+*  through one std::ostringstream.
+*/
+template <typename _Tp, typename _Alloc, typename _Policy, typename _Sink>
+void
+format_chunked(const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x, _Sink __sink)
+{
+  char __buf[4096];
+  std::size_t __n = 0;
+  auto __put = [&](const char* __p, std::size_t __k)
+  {
+    if (__n + __k > sizeof(__buf))
+    {
+      if (__n)
+        __sink(static_cast<const char*>(__buf), __n);
+      __n = 0;
+      if (__k > sizeof(__buf))
+      {
+        __sink(__p, __k);
+        return;
+      }
+    }
+    std::memcpy(__buf + __n, __p, __k);
+    __n += __k;
+  };
+
+  std::ostringstream __os;
+  __put("[ ", 2);
+  for (auto i = __x.begin(); i != __x.end(); ++i)
+  {
+    if (!*i)
+      __put("NULL ", 5);
+    else if constexpr (shared_ptr_vector_formattable<_Tp>::value)
+    {
+      const std::size_t __k = shared_ptr_vector_format<_Tp>::size(**i) + 1;
+      if (__n + __k > sizeof(__buf) && __n)
+      {
+        __sink(static_cast<const char*>(__buf), __n);
+        __n = 0;
+      }
+      if (__k > sizeof(__buf))
+      {
+        std::string __big(__k, ' ');
+        char* __e = shared_ptr_vector_format<_Tp>::format(&__big[0], **i);
+        *__e++ = ' ';
+        __sink(static_cast<const char*>(__big.data()), std::size_t(__e - __big.data()));
+        continue;
+      }
+      char* __e = shared_ptr_vector_format<_Tp>::format(__buf + __n, **i);
+      *__e++ = ' ';
+      __n = std::size_t(__e - __buf);
+    }
+    else
+    {
+      __os.str(std::string());
+      __os << **i << ' ';
+      const std::string& __s = __os.str();
+      __put(__s.data(), __s.size());
+    }
+  }
+  __put("]", 1);
+  __sink(static_cast<const char*>(__buf), __n);
+}
+
+/**
+*  @brief  Writes the elements of the shared_ptr_vector to an output
+*          iterator.
+*  @param  __o  An output iterator of char, a buffer of formatted_size()
+*               chars for example.
+*  @param  __x  A shared_ptr_vector.
+*  @return  The end of the output.
+*
+*  The text is that of to_string().
+*/
+template <typename _Out, typename _Tp, typename _Alloc, typename _Policy>
+_Out
+format_to(_Out __o, const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x)
+{
+  format_chunked(__x, [&__o](const char* __p, std::size_t __k) { __o = std::copy(__p, __p + __k, __o); });
+  return __o;
+}
+
 /**
 *  @brief  convert the elements of the shared_ptr_vector to string.
 *  @param  __x  A shared_ptr_vector.
 *  @return  string representing shared_ptr_vector
 *
 *  This converts shared_ptr_vector to string.
-*  The elements must have << operation.
+*  The elements must have << operation, or shared_ptr_vector_format;
+*  with shared_ptr_vector_format the string is allocated once, at
+*  formatted_size(), and written in place.
 */
-template <typename _Tp, typename _Alloc>
+template <typename _Tp, typename _Alloc, typename _Policy>
 std::string
-to_string(const shared_ptr_vector<_Tp, _Alloc>& __x)
+to_string(const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x)
 {
-  std::stringstream ss;
-  ss << "[ ";
-  for (auto i = __x.begin(); i != __x.end(); ++i)
+  if constexpr (shared_ptr_vector_formattable<_Tp>::value)
   {
-    if (*i)
-      ss << **i << " ";
-    else
-      ss << "NULL ";
+    std::string __s(formatted_size(__x), ' ');
+    char* __p = &__s[0];
+    *__p++ = '[';
+    *__p++ = ' ';
+    for (auto i = __x.begin(); i != __x.end(); ++i)
+    {
+      if (*i)
+        __p = shared_ptr_vector_format<_Tp>::format(__p, **i);
+      else
+        __p = std::copy_n("NULL", 4, __p);
+      *__p++ = ' ';
+    }
+    *__p++ = ']';
+    __s.resize(std::size_t(__p - __s.data()));
+    return __s;
+  }
+  else
+  {
+    std::stringstream ss;
+    ss << "[ ";
+    for (auto i = __x.begin(); i != __x.end(); ++i)
+    {
+      if (*i)
+        ss << **i << " ";
+      else
+        ss << "NULL ";
+    }
+    ss << "]";
+    return ss.str();
   }
-  ss << "]";
-  return ss.str();
 }
 
 /**
@@ -1267,12 +3688,22 @@ to_string(const shared_ptr_vector<_Tp, _Alloc>& __x)
 *  @return  os(input ostreeam)
 *
 *  This outpus the element of the shared_ptr_vector to ostream.
-*  The elements must have << operation.
+*  The elements must have << operation.  Elements with
+*  shared_ptr_vector_format go through format_chunked() when os has the
+*  default flags, precision and width.
 */
-template <typename _Tp, typename _Alloc>
+template <typename _Tp, typename _Alloc, typename _Policy>
 std::ostream&
-operator<<(std::ostream& os, const shared_ptr_vector<_Tp, _Alloc>& __x)
+operator<<(std::ostream& os, const shared_ptr_vector<_Tp, _Alloc, _Policy>& __x)
 {
+  if constexpr (shared_ptr_vector_formattable<_Tp>::value)
+  {
+    if (os.flags() == (std::ios_base::skipws | std::ios_base::dec) && os.precision() == 6 && os.width() == 0)
+    {
+      format_chunked(__x, [&os](const char* __p, std::size_t __k) { os.write(__p, std::streamsize(__k)); });
+      return os;
+    }
+  }
   os << "[ ";
   for (auto i = __x.begin(); i != __x.end(); ++i)
   {
@@ -1294,12 +3725,25 @@ operator<<(std::ostream& os, const shared_ptr_vector<_Tp, _Alloc>& __x)
 *  This outpus the element of the shared_ptr_vector to ostream.
 *  The elements must have << operation.
 */
-template <typename _Tp, typename _Alloc>
+template <typename _Tp, typename _Alloc, typename _Policy>
+void
+sort(shared_ptr_vector<_Tp, _Alloc, _Policy>& __x)
+{
+  __x.sort();
+}
+
+/**
+*  @brief  sort the elements of the shared_ptr_vector in parallel.
+*  @param  __par  The threads to use.
+*  @param  __x  A shared_ptr_vector.
+*
+*  See shared_ptr_vector::sort(const shared_ptr_vector_parallel&).
+*/
+template <typename _Tp, typename _Alloc, typename _Policy>
 void
-sort(shared_ptr_vector<_Tp, _Alloc>& __x)
+sort(const shared_ptr_vector_parallel& __par, shared_ptr_vector<_Tp, _Alloc, _Policy>& __x)
 {
-  typedef typename shared_ptr_vector<_Tp, _Alloc>::shared_ptr_value_less shared_ptr_value_less;
-  std::sort(__x.begin(), __x.end(), shared_ptr_value_less());
+  __x.sort(__par);
 }
 
 
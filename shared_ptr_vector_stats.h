@@ -0,0 +1,122 @@
+#ifndef _shared_ptr_vector_stats_h_
+#define _shared_ptr_vector_stats_h_
+
+/**
+ * shared_ptr_vector_stats counts allocations and reference counts of shared_ptr_vector
+ * author : dhan71@naver.com
+ */
+/**
+*  @brief  Allocation and reference count statistics of shared_ptr_vector.
+*
+*  The counters are kept only when SHARED_PTR_VECTOR_STATS is defined;
+*  otherwise the counting points compile to nothing and the counters
+*  stay 0.  Define it, or not, for the whole program: the members of
+*  shared_ptr_vector are inline, and translation units which disagree
+*  on the macro give two definitions of them (an ODR violation), of
+*  which the linker keeps one.  The layout of shared_ptr_vector is the
+*  same either way.
+*
+*  Each shared_ptr_vector counts what its own operations do, in plain
+*  integers, and adds the same to global counters shared by all the
+*  shared_ptr_vectors of the program, with relaxed atomics.  The global
+*  bytes_reserved and bytes_used are those of the live shared_ptr_vectors.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ *  Kinds of counted events.
+ */
+enum class shared_ptr_vector_counter : unsigned char
+{
+  element_allocations,        // elements built by the container
+  control_block_allocations,  // reference counts made for adopted pointers
+  spine_reallocations,        // slot buffers allocated or moved
+  refcount_increments,        // slots copied from a held element
+  refcount_decrements,        // slots released while holding an element
+  bytes_reserved,             // slot buffer capacity, in bytes
+  bytes_used                  // slots in use, in bytes
+};
+
+/**
+ *  Counters of a shared_ptr_vector, or of all of them.
+ *
+ *  An element built with make_shared (emplace_back, push_back of a
+ *  value) is one element_allocation: its reference count is in the same
+ *  block.  A pointer given to push_back, insert or at() gets its own
+ *  control block, except with intrusive_ptr_policy.  Reference counts
+ *  are atomic with shared_ptr_policy.
+ */
+struct shared_ptr_vector_stats
+{
+  std::uint64_t element_allocations = 0;
+  std::uint64_t control_block_allocations = 0;
+  std::uint64_t spine_reallocations = 0;
+  std::uint64_t refcount_increments = 0;
+  std::uint64_t refcount_decrements = 0;
+  std::uint64_t bytes_reserved = 0;
+  std::uint64_t bytes_used = 0;
+
+  std::uint64_t&
+  operator[](shared_ptr_vector_counter __c)
+  {
+    switch (__c)
+    {
+    case shared_ptr_vector_counter::element_allocations:       return element_allocations;
+    case shared_ptr_vector_counter::control_block_allocations: return control_block_allocations;
+    case shared_ptr_vector_counter::spine_reallocations:       return spine_reallocations;
+    case shared_ptr_vector_counter::refcount_increments:       return refcount_increments;
+    case shared_ptr_vector_counter::refcount_decrements:       return refcount_decrements;
+    case shared_ptr_vector_counter::bytes_reserved:            return bytes_reserved;
+    case shared_ptr_vector_counter::bytes_used:                break;
+    }
+    return bytes_used;
+  }
+
+  /**
+   *  @brief  Returns the counters of all the shared_ptr_vectors.
+   */
+  static shared_ptr_vector_stats
+  global()
+  {
+    shared_ptr_vector_stats __s;
+    for (unsigned __i = 0; __i < _S_counters; ++__i)
+      __s[shared_ptr_vector_counter(__i)] = _S_global()[__i].load(std::memory_order_relaxed);
+    return __s;
+  }
+
+  /**
+   *  @brief  Sets the global event counters to 0.
+   *
+   *  bytes_reserved and bytes_used are kept, since they describe the
+   *  live containers.
+   */
+  static void
+  reset_global()
+  {
+    for (unsigned __i = 0; __i < unsigned(shared_ptr_vector_counter::bytes_reserved); ++__i)
+      _S_global()[__i].store(0, std::memory_order_relaxed);
+  }
+
+  /**  Adds @a __n (which may wrap, to subtract) to a global counter.  */
+  static void
+  add_global(shared_ptr_vector_counter __c, std::uint64_t __n)
+  {
+    if (__n)
+      _S_global()[unsigned(__c)].fetch_add(__n, std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr unsigned _S_counters = unsigned(shared_ptr_vector_counter::bytes_used) + 1;
+
+  static std::atomic<std::uint64_t>*
+  _S_global()
+  {
+    static std::atomic<std::uint64_t> __counters[_S_counters] = { };
+    return __counters;
+  }
+};
+
+#endif /* _shared_ptr_vector_stats_h_ */
@@ -0,0 +1,299 @@
+#ifndef _shared_ptr_vector_trace_h_
+#define _shared_ptr_vector_trace_h_
+
+/**
+ * shared_ptr_vector_trace records shared_ptr_vector operations
+ * author : dhan71@naver.com
+ */
+/**
+*  @brief  Event tracing for shared_ptr_vector.
+*
+*  Included by shared_ptr_vector.h when SHARED_PTR_VECTOR_TRACE is
+*  defined; otherwise the trace points compile to nothing.
+*
+*  Each thread records its events into its own ring buffer of
+*  SHARED_PTR_VECTOR_TRACE_CAPACITY events, without locks and without
+*  I/O.  Older events are overwritten.  The buffers of all threads can be
+*  read later, from any thread, by shared_ptr_vector_trace::events() or
+*  shared_ptr_vector_trace::dump().
+*
+*  A thread gives its buffer back when it exits, and the next new thread
+*  records into it, so there are as many buffers as threads running at
+*  once.  The events of an exited thread stay until they are overwritten.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#ifndef SHARED_PTR_VECTOR_TRACE_CAPACITY
+#define SHARED_PTR_VECTOR_TRACE_CAPACITY 4096
+#endif
+
+/**
+ *  Kinds of traced operations.
+ */
+enum class shared_ptr_vector_op : unsigned char
+{
+  ctor,
+  copy_ctor,
+  dtor,
+  copy_assign,
+  move_assign,
+  assign,
+  resize,
+  insert,
+  sort,
+  clear
+};
+
+inline const char*
+to_string(shared_ptr_vector_op __op)
+{
+  switch (__op)
+  {
+  case shared_ptr_vector_op::ctor:        return "ctor";
+  case shared_ptr_vector_op::copy_ctor:   return "copy_ctor";
+  case shared_ptr_vector_op::dtor:        return "dtor";
+  case shared_ptr_vector_op::copy_assign: return "copy_assign";
+  case shared_ptr_vector_op::move_assign: return "move_assign";
+  case shared_ptr_vector_op::assign:      return "assign";
+  case shared_ptr_vector_op::resize:      return "resize";
+  case shared_ptr_vector_op::insert:      return "insert";
+  case shared_ptr_vector_op::sort:        return "sort";
+  case shared_ptr_vector_op::clear:       return "clear";
+  }
+  return "?";
+}
+
+/**
+ *  A recorded operation.
+ */
+struct shared_ptr_vector_event
+{
+  shared_ptr_vector_op op;
+  unsigned             thread;      // index of the recording thread
+  const void*          container;
+  std::size_t          size;        // size of the container after the operation
+  std::uint64_t        start_ns;    // steady_clock time
+  std::uint64_t        duration_ns;
+};
+
+class shared_ptr_vector_trace
+{
+public:
+  /**
+   *  @brief  Records an event into the ring buffer of the calling thread.
+   */
+  static void
+  record(shared_ptr_vector_op __op, const void* __c, std::size_t __n, std::uint64_t __start, std::uint64_t __dur)
+  {
+    _Ring& __r = _S_local();
+    const std::uint64_t __i = __r.head.load(std::memory_order_relaxed);
+    _Slot& __s = __r.slots[__i % SHARED_PTR_VECTOR_TRACE_CAPACITY];
+    // odd sequence while writing, so readers can skip torn slots
+    __s.seq.store(2 * __i + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    __s.op.store(__op, std::memory_order_relaxed);
+    __s.thread.store(__r.index, std::memory_order_relaxed);
+    __s.container.store(__c, std::memory_order_relaxed);
+    __s.size.store(__n, std::memory_order_relaxed);
+    __s.start.store(__start, std::memory_order_relaxed);
+    __s.duration.store(__dur, std::memory_order_relaxed);
+    __s.seq.store(2 * __i + 2, std::memory_order_release);
+    __r.head.store(__i + 1, std::memory_order_release);
+  }
+
+  /**
+   *  @brief  Returns the events still in the ring buffers of all
+   *          threads, ordered by start time.
+   */
+  static std::vector<shared_ptr_vector_event>
+  events()
+  {
+    std::vector<shared_ptr_vector_event> __v;
+    for (_Ring* __r = _S_rings().load(std::memory_order_acquire); __r; __r = __r->next)
+    {
+      const std::uint64_t __h = __r->head.load(std::memory_order_acquire);
+      const std::uint64_t __b = __r->tail.load(std::memory_order_relaxed);
+      const std::uint64_t __f = std::max(__b, __h > SHARED_PTR_VECTOR_TRACE_CAPACITY ? __h - SHARED_PTR_VECTOR_TRACE_CAPACITY : 0);
+      for (std::uint64_t __i = __f; __i < __h; ++__i)
+      {
+        const _Slot& __s = __r->slots[__i % SHARED_PTR_VECTOR_TRACE_CAPACITY];
+        shared_ptr_vector_event __e;
+        const std::uint64_t __seq = __s.seq.load(std::memory_order_acquire);
+        __e.op          = __s.op.load(std::memory_order_relaxed);
+        __e.thread      = __s.thread.load(std::memory_order_relaxed);
+        __e.container   = __s.container.load(std::memory_order_relaxed);
+        __e.size        = __s.size.load(std::memory_order_relaxed);
+        __e.start_ns    = __s.start.load(std::memory_order_relaxed);
+        __e.duration_ns = __s.duration.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (__seq == 2 * __i + 2 && __s.seq.load(std::memory_order_relaxed) == __seq)
+          __v.push_back(__e);
+      }
+    }
+    std::stable_sort(__v.begin(), __v.end(),
+                     [](const shared_ptr_vector_event& __x, const shared_ptr_vector_event& __y)
+                     { return __x.start_ns < __y.start_ns; });
+    return __v;
+  }
+
+  /**
+   *  @brief  Writes the events of events() to @a os, one per line.
+   */
+  static std::ostream&
+  dump(std::ostream& __os)
+  {
+    std::vector<shared_ptr_vector_event> __v = events();
+    for (auto __i = __v.begin(); __i != __v.end(); ++__i)
+      __os << __i->start_ns << " T" << __i->thread << " " << to_string(__i->op)
+           << " " << __i->container << " n=" << __i->size << " " << __i->duration_ns << "ns\n";
+    return __os;
+  }
+
+  /**
+   *  @brief  Forgets the recorded events.
+   *
+   *  Events being recorded at the same time may or may not be kept.
+   */
+  static void
+  clear()
+  {
+    for (_Ring* __r = _S_rings().load(std::memory_order_acquire); __r; __r = __r->next)
+      __r->tail.store(__r->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+  }
+
+  /**
+   *  @brief  Returns the number of ring buffers, at most the number of
+   *          threads which have recorded at the same time.
+   */
+  static std::size_t
+  buffers()
+  {
+    std::size_t __n = 0;
+    for (_Ring* __r = _S_rings().load(std::memory_order_acquire); __r; __r = __r->next)
+      ++__n;
+    return __n;
+  }
+
+  static std::uint64_t
+  now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+private:
+  struct _Slot
+  {
+    std::atomic<std::uint64_t>        seq{0};
+    std::atomic<shared_ptr_vector_op> op{shared_ptr_vector_op::ctor};
+    std::atomic<unsigned>             thread{0};
+    std::atomic<const void*>          container{nullptr};
+    std::atomic<std::size_t>          size{0};
+    std::atomic<std::uint64_t>        start{0};
+    std::atomic<std::uint64_t>        duration{0};
+  };
+
+  // Rings are linked into a list and never freed, so that the events of
+  // finished threads can still be read.  A ring no longer active is taken
+  // over by the next new thread, which goes on from its head.
+  struct _Ring
+  {
+    _Slot                      slots[SHARED_PTR_VECTOR_TRACE_CAPACITY];
+    std::atomic<std::uint64_t> head{0};
+    std::atomic<std::uint64_t> tail{0};
+    std::atomic<bool>          active{true};
+    unsigned                   index = 0;   // of the owning thread
+    _Ring*                     next = nullptr;
+  };
+
+  // gives the ring of the thread back when the thread exits
+  struct _Owner
+  {
+    explicit
+    _Owner(_Ring* __r)
+    : iRing(__r)
+    { }
+
+    ~_Owner()
+    {
+      iRing->active.store(false, std::memory_order_release);
+    }
+
+    _Ring* iRing;
+  };
+
+  static std::atomic<_Ring*>&
+  _S_rings()
+  {
+    static std::atomic<_Ring*> __rings{nullptr};
+    return __rings;
+  }
+
+  static _Ring&
+  _S_local()
+  {
+    static thread_local _Owner __o(_S_acquire());
+    return *__o.iRing;
+  }
+
+  // reuses the ring of an exited thread, or adds one
+  static _Ring*
+  _S_acquire()
+  {
+    static std::atomic<unsigned> __count{0};
+    const unsigned __index = __count.fetch_add(1, std::memory_order_relaxed);
+    for (_Ring* __r = _S_rings().load(std::memory_order_acquire); __r; __r = __r->next)
+    {
+      bool __f = false;
+      if (!__r->active.load(std::memory_order_relaxed)
+          && __r->active.compare_exchange_strong(__f, true, std::memory_order_acquire))
+      {
+        __r->index = __index;
+        return __r;
+      }
+    }
+    _Ring* __r = new _Ring;
+    __r->index = __index;
+    __r->next = _S_rings().load(std::memory_order_relaxed);
+    while (!_S_rings().compare_exchange_weak(__r->next, __r, std::memory_order_release, std::memory_order_relaxed))
+      ;
+    return __r;
+  }
+};
+
+/**
+ *  Records an operation on a container from the construction of the
+ *  scope to its destruction, with the size of the container at the end.
+ */
+template<typename _Container>
+class shared_ptr_vector_trace_scope
+{
+public:
+  shared_ptr_vector_trace_scope(shared_ptr_vector_op __op, const _Container* __c)
+  : iOp(__op)
+  , iContainer(__c)
+  , iStart(shared_ptr_vector_trace::now())
+  { }
+
+  ~shared_ptr_vector_trace_scope()
+  {
+    shared_ptr_vector_trace::record(iOp, iContainer, iContainer->size(), iStart, shared_ptr_vector_trace::now() - iStart);
+  }
+
+  shared_ptr_vector_trace_scope(const shared_ptr_vector_trace_scope&) = delete;
+  shared_ptr_vector_trace_scope& operator=(const shared_ptr_vector_trace_scope&) = delete;
+
+private:
+  shared_ptr_vector_op iOp;
+  const _Container*    iContainer;
+  std::uint64_t        iStart;
+};
+
+#endif /* _shared_ptr_vector_trace_h_ */
@@ -0,0 +1,377 @@
+#ifndef _sorted_shared_ptr_vector_h_
+#define _sorted_shared_ptr_vector_h_
+
+/**
+ * sorted_shared_ptr_vector is a shared_ptr_vector kept in order
+ * author : dhan71@naver.com
+ */
+/**
+*  @brief  An adapter which keeps a shared_ptr_vector sorted by
+*  shared_ptr_value_less (NULL is last element).
+*
+*  @tparam _Tp  Type of element.
+*  @tparam _Alloc  Allocator type of the shared_ptr_vector.
+*  @tparam _Policy  Ownership policy of the shared_ptr_vector.
+*
+*  find_value(), lower_bound(), upper_bound() and equal_range() are
+*  binary searches.  insert_sorted() puts one element at its place, and
+*  merge_sorted() puts a batch in with a single merge instead of one
+*  shifting insert per element.  Elements with equal values keep the order
+*  in which they were added.
+*
+*  The elements are reached only through const pointers, since changing
+*  a value could break the order.
+*/
+
+#include <shared_ptr_vector.h>
+
+template<typename _Tp, typename _Alloc = std::allocator<std::shared_ptr<_Tp> >, typename _Policy = typename default_ptr_policy<_Tp>::type>
+class sorted_shared_ptr_vector
+{
+public:
+  typedef shared_ptr_vector<_Tp, _Alloc, _Policy> base_type;
+
+  typedef typename base_type::value_type             value_type;
+  typedef typename base_type::data_type              data_type;
+  typedef typename base_type::const_data_type        const_data_type;
+  typedef typename base_type::shared_data_type       shared_data_type;
+  typedef typename base_type::const_reference        const_reference;
+  typedef typename base_type::const_iterator         const_iterator;
+  typedef typename base_type::const_reverse_iterator const_reverse_iterator;
+  typedef typename base_type::size_type              size_type;
+  typedef typename base_type::difference_type        difference_type;
+  typedef typename base_type::shared_ptr_value_less  shared_ptr_value_less;
+
+public:
+  /**
+   *  @brief  Creates a sorted_shared_ptr_vector with no elements.
+   */
+  sorted_shared_ptr_vector()
+  { }
+
+  /**
+   *  @brief  Creates a sorted_shared_ptr_vector from the elements of a
+   *          shared_ptr_vector.
+   *  @param  __x  A shared_ptr_vector, which is sorted (stable).
+   */
+  explicit
+  sorted_shared_ptr_vector(base_type __x)
+  : iList(std::move(__x))
+  {
+    std::stable_sort(iList.begin(), iList.end(), shared_ptr_value_less());
+    iList.rebuild_index();
+  }
+
+  /**
+   *  @brief  Builds a sorted_shared_ptr_vector from an initializer list.
+   *  @param  __l  An initializer_list of pointers, owned afterwards.
+   */
+  sorted_shared_ptr_vector(std::initializer_list<data_type> __l)
+  {
+    merge_sorted(__l.begin(), __l.end());
+  }
+
+public:
+  // iterators
+  const_iterator
+  begin() const
+  { return iList.begin(); }
+
+  const_iterator
+  end() const
+  { return iList.end(); }
+
+  const_reverse_iterator
+  rbegin() const
+  { return iList.rbegin(); }
+
+  const_reverse_iterator
+  rend() const
+  { return iList.rend(); }
+
+  // capacity
+  size_type
+  size() const
+  { return iList.size(); }
+
+  bool
+  empty() const
+  { return iList.empty(); }
+
+  void
+  reserve(size_type __n)
+  { iList.reserve(__n); }
+
+  // element access
+  const_reference
+  operator[](size_type __n) const
+  { return iList[__n]; }
+
+  const_reference
+  at(size_type __n) const
+  { return iList.at(__n); }
+
+  const_reference
+  front() const
+  { return iList.front(); }
+
+  const_reference
+  back() const
+  { return iList.back(); }
+
+  /**  Returns the underlying shared_ptr_vector.  */
+  const base_type&
+  base() const
+  { return iList; }
+
+  /**
+   *  @brief  Gives up the elements.
+   *  @return  The underlying shared_ptr_vector, sorted.
+   *
+   *  Afterwards this sorted_shared_ptr_vector is empty.
+   */
+  base_type
+  release()
+  {
+    base_type __r(std::move(iList));
+    iList.clear();
+    return __r;
+  }
+
+public:
+  // search
+  /**
+   *  @brief  Finds the first element not less than a value.
+   *  @param  __x  A value.
+   *  @return  iterator of the first element not less than @a __x, which
+   *           may be a NULL slot or end().
+   */
+  const_iterator
+  lower_bound(const value_type& __x) const
+  {
+    return std::lower_bound(begin(), end(), __x,
+                            [](const shared_data_type& __p, const value_type& __v)
+                            { return __p && *__p < __v; });
+  }
+
+  /**
+   *  @brief  Finds the first element greater than a value.
+   *  @param  __x  A value.
+   *  @return  iterator of the first element greater than @a __x, which
+   *           may be a NULL slot or end().
+   */
+  const_iterator
+  upper_bound(const value_type& __x) const
+  { return _S_upper_bound(begin(), end(), __x); }
+
+  /**
+   *  @brief  Finds the elements equal to a value.
+   *  @param  __x  A value.
+   *  @return  pair of lower_bound() and upper_bound().
+   */
+  std::pair<const_iterator, const_iterator>
+  equal_range(const value_type& __x) const
+  {
+    return std::make_pair(lower_bound(__x), upper_bound(__x));
+  }
+
+  /**
+   *  @brief  Finds the first element equal to a value, in O(log n).
+   *  @param  __x  A value.
+   *  @return  iterator where __x is, or end().
+   */
+  const_iterator
+  find_value(const value_type& __x) const
+  {
+    const_iterator __i = lower_bound(__x);
+    if (__i != end() && *__i && **__i == __x)
+      return __i;
+    return end();
+  }
+  const_iterator
+  find_value(const const_data_type& __x) const
+  {
+    if (__x)
+      return find_value(*__x);
+    else
+      return end();
+  }
+
+  /**
+   *  @brief  find the position where __x is.
+   *  @param  __x  A pointer
+   *  @return  iterator where __x is
+   *
+   *  This is a binary search for the value of @a __x followed by a scan of
+   *  the equal elements.
+   */
+  const_iterator
+  find(const const_data_type& __x) const
+  {
+    if (!__x)
+      return std::find_if(lower_bound_null(), end(), [](const shared_data_type& __p) { return !__p; });
+    std::pair<const_iterator, const_iterator> __r = equal_range(*__x);
+    for (const_iterator __i = __r.first; __i != __r.second; ++__i)
+      if (__i->get() == __x)
+        return __i;
+    return end();
+  }
+
+  /**  Returns the iterator of the first NULL slot, or end().  */
+  const_iterator
+  lower_bound_null() const
+  {
+    return std::partition_point(begin(), end(), [](const shared_data_type& __p) { return (bool)__p; });
+  }
+
+public:
+  // modifiers
+  /**
+   *  @brief  Inserts an element at its place.
+   *  @param  __x  Data to be inserted, owned afterwards.
+   *  @return  An iterator that points to the inserted data.
+   *
+   *  The element goes after the elements equal to it.  This shifts the
+   *  following elements; for many elements use merge_sorted().
+   */
+  const_iterator
+  insert_sorted(const data_type& __x)
+  {
+    const_iterator __pos = __x ? upper_bound(*__x) : end();
+    return iList.insert(__pos, __x);
+  }
+
+  /**
+   *  @brief  Constructs an element at its place.
+   *  @param  __args  Arguments forwarded to the constructor of _Tp.
+   *  @return  An iterator that points to the inserted data.
+   */
+  template<typename... _Args>
+  const_iterator
+  emplace_sorted(_Args&&... __args)
+  {
+    // constructed at the back (from the pool, if any), then rotated in
+    iList.emplace_back(std::forward<_Args>(__args)...);
+    // searched without the new element, which is not in order yet
+    typename base_type::iterator __last = iList.end() - 1;
+    typename base_type::iterator __pos = _S_upper_bound(iList.begin(), __last, **__last);
+    std::rotate(__pos, __last, iList.end());
+    iList.rebuild_index();
+    return __pos;
+  }
+
+  /**
+   *  @brief  Inserts a batch of elements with a single merge.
+   *  @param  __first  An input iterator of data_type.
+   *  @param  __last   An input iterator of data_type.
+   *
+   *  The batch is sorted on its own and then merged with the elements
+   *  from the back, so that every slot moves at most once: O(n + m log m)
+   *  instead of m shifting inserts.  Elements of the batch go after the
+   *  elements equal to them.
+   */
+  template<typename _InputIterator>
+  void
+  merge_sorted(_InputIterator __first, _InputIterator __last)
+  {
+    std::vector<shared_data_type> __batch;
+    for ( ; __first != __last; ++__first)
+      __batch.push_back(shared_data_type(*__first));
+    _M_merge(__batch);
+  }
+
+  /**
+   *  @brief  Inserts the elements of a shared_ptr_vector with a single merge.
+   *  @param  __x  A shared_ptr_vector whose elements are shared.
+   */
+  void
+  merge_sorted(const base_type& __x)
+  {
+    std::vector<shared_data_type> __batch(__x.begin(), __x.end());
+    _M_merge(__batch);
+  }
+
+  const_iterator
+  erase(const_iterator __position)
+  { return iList.erase(__position); }
+
+  const_iterator
+  erase(const_iterator __first, const_iterator __last)
+  { return iList.erase(__first, __last); }
+
+  void
+  pop_back()
+  { iList.pop_back(); }
+
+  void
+  clear()
+  { iList.clear(); }
+
+  void
+  swap(sorted_shared_ptr_vector& __x)
+  { iList.swap(__x.iList); }
+
+private:
+  template<typename _Iterator>
+  static _Iterator
+  _S_upper_bound(_Iterator __first, _Iterator __last, const value_type& __x)
+  {
+    return std::upper_bound(__first, __last, __x,
+                            [](const value_type& __v, const shared_data_type& __p)
+                            { return !__p || __v < *__p; });
+  }
+
+  void
+  _M_merge(std::vector<shared_data_type>& __batch)
+  {
+    if (__batch.empty())
+      return;
+    std::stable_sort(__batch.begin(), __batch.end(), shared_ptr_value_less());
+
+    const size_type __n = iList.size();
+    iList.resize(__n + __batch.size());
+    typename base_type::iterator __a = iList.begin();
+    difference_type __i = __n;
+    difference_type __j = __batch.size();
+    difference_type __k = iList.size();
+    // from the back: on equal values the batch element goes last
+    while (__j > 0)
+    {
+      if (__i > 0 && shared_ptr_value_less()(__batch[__j - 1], __a[__i - 1]))
+        __a[--__k] = std::move(__a[--__i]);
+      else
+        __a[--__k] = std::move(__batch[--__j]);
+    }
+    iList.rebuild_index();
+  }
+
+  base_type iList;
+};
+
+/// Based on shared_ptr_vector operator==
+template<typename _Tp, typename _Alloc, typename _Policy>
+inline bool
+operator==(const sorted_shared_ptr_vector<_Tp, _Alloc, _Policy>& __x, const sorted_shared_ptr_vector<_Tp, _Alloc, _Policy>& __y)
+{ return __x.base() == __y.base(); }
+
+template<typename _Tp, typename _Alloc, typename _Policy>
+inline bool
+operator!=(const sorted_shared_ptr_vector<_Tp, _Alloc, _Policy>& __x, const sorted_shared_ptr_vector<_Tp, _Alloc, _Policy>& __y)
+{ return !(__x == __y); }
+
+template<typename _Tp, typename _Alloc, typename _Policy>
+inline void
+swap(sorted_shared_ptr_vector<_Tp, _Alloc, _Policy>& __x, sorted_shared_ptr_vector<_Tp, _Alloc, _Policy>& __y)
+{ __x.swap(__y); }
+
+template <typename _Tp, typename _Alloc, typename _Policy>
+std::string
+to_string(const sorted_shared_ptr_vector<_Tp, _Alloc, _Policy>& __x)
+{ return to_string(__x.base()); }
+
+template <typename _Tp, typename _Alloc, typename _Policy>
+std::ostream&
+operator<<(std::ostream& os, const sorted_shared_ptr_vector<_Tp, _Alloc, _Policy>& __x)
+{ return os << __x.base(); }
+
+#endif /* _sorted_shared_ptr_vector_h_ */
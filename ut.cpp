@@ -4,7 +4,17 @@
 #include <cppunit/ui/text/TextTestRunner.h>
 
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
 #include <shared_ptr_vector.h>
+#include <sorted_shared_ptr_vector.h>
+#include <concurrent_shared_ptr_vector.h>
+#include <cow_shared_ptr_vector.h>
+#include <sharded_shared_ptr_vector.h>
+#include <atomic_shared_ptr_vector.h>
+#include <mapped_shared_ptr_vector.h>
 using namespace std;
 
 class TObj
@@ -68,6 +78,79 @@ operator<<(ostream& os, const TObj& a)
   os << "(" << a.getN() << "," << a.getS() << ")";
   return os;
 }
+template<>
+struct shared_ptr_vector_serial<TObj>
+{
+  template<typename _Writer>
+  static void write(_Writer& w, const TObj& x)
+  {
+    int n = x.getN();
+    size_t len = x.getS().size();
+    w.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    w.write(reinterpret_cast<const char*>(&len), sizeof(len));
+    w.write(x.getS().data(), len);
+  }
+  template<typename _Reader>
+  static TObj read(_Reader& r)
+  {
+    int n;
+    size_t len;
+    r.read(reinterpret_cast<char*>(&n), sizeof(n));
+    r.read(reinterpret_cast<char*>(&len), sizeof(len));
+    string s(len, ' ');
+    r.read(&s[0], len);
+    return TObj(n, s);
+  }
+};
+
+class TRef
+{
+public:
+  TRef(int a)
+    : iN(a)
+    , iCount(0)
+  { }
+
+public:
+  int getN() const
+  {
+    return iN;
+  }
+  int count() const
+  {
+    return iCount;
+  }
+
+private:
+  friend void intrusive_add_ref(TRef* p)
+  {
+    ++p->iCount;
+  }
+  friend void intrusive_release(TRef* p)
+  {
+    if (--p->iCount == 0)
+      delete p;
+  }
+
+  int iN;
+  int iCount;
+};
+bool
+operator==(const TRef& lhs, const TRef& rhs)
+{
+  return lhs.getN() == rhs.getN();
+}
+bool
+operator<(const TRef& lhs, const TRef& rhs)
+{
+  return lhs.getN() < rhs.getN();
+}
+ostream&
+operator<<(ostream& os, const TRef& a)
+{
+  os << a.getN();
+  return os;
+}
 
 bool
 int_less(int a, int b)
@@ -647,6 +730,385 @@ public:
     CPPUNIT_ASSERT_EQUAL(3, itr->get()->getN());
     CPPUNIT_ASSERT_EQUAL(string("C"), itr->get()->getS());
   }
+  void test_push3()
+  {
+    title("test_push3() called");
+
+    shared_ptr_vector<TObj> v1;
+    TObj t1(1, "A");
+    v1.push_back(t1);
+    v1.push_back(TObj(2, "B"));
+    CPPUNIT_ASSERT(2 == v1.size());
+    CPPUNIT_ASSERT(&t1 != v1.front());
+    CPPUNIT_ASSERT(t1 == *v1.front());
+    CPPUNIT_ASSERT_EQUAL(2, v1.back()->getN());
+    CPPUNIT_ASSERT_EQUAL(string("B"), v1.back()->getS());
+  }
+  void test_adopt1()
+  {
+    title("test_adopt1() called");
+
+    vector<shared_ptr<int> > v2{make_shared<int>(1), nullptr, make_shared<int>(2)};
+    const int* p1 = v2[0].get();
+    shared_ptr_vector<int> v1{new int(9)};
+    v1.enable_index();
+    v1.adopt(std::move(v2));
+    CPPUNIT_ASSERT(v2.empty());
+    CPPUNIT_ASSERT("[ 1 NULL 2 ]" == to_string(v1));
+    CPPUNIT_ASSERT(v1.find_value(2) == v1.begin() + 2);
+    CPPUNIT_ASSERT_EQUAL(1L, v1.begin()->use_count());
+
+    shared_ptr<int> s1 = make_shared<int>(3);
+    v1.push_back(std::move(s1));
+    CPPUNIT_ASSERT(s1 == nullptr);
+    shared_ptr<int> s2 = make_shared<int>(0);
+    shared_ptr_vector<int>::iterator itr = v1.insert(v1.begin(), std::move(s2));
+    CPPUNIT_ASSERT(s2 == nullptr);
+    CPPUNIT_ASSERT(itr == v1.begin());
+    CPPUNIT_ASSERT_EQUAL(1L, itr->use_count());
+    CPPUNIT_ASSERT("[ 0 1 NULL 2 3 ]" == to_string(v1));
+    CPPUNIT_ASSERT(v1.find_value(3) == v1.begin() + 4);
+
+    shared_ptr_vector<int>::_vector_type v3 = v1.release();
+    CPPUNIT_ASSERT(v1.empty());
+    CPPUNIT_ASSERT(5 == v3.size());
+    CPPUNIT_ASSERT(p1 == v3[1].get());
+    CPPUNIT_ASSERT_EQUAL(1L, v3[1].use_count());
+    CPPUNIT_ASSERT(v1.find_value(3) == v1.end());
+  }
+  template<typename _Tp>
+  struct CountAlloc
+  {
+    typedef _Tp value_type;
+    CountAlloc(int* __n) : n(__n) { }
+    template<typename _Up>
+    CountAlloc(const CountAlloc<_Up>& __a) : n(__a.n) { }
+    _Tp* allocate(size_t __k)
+    {
+      ++*n;
+      return std::allocator<_Tp>().allocate(__k);
+    }
+    void deallocate(_Tp* __p, size_t __k)
+    {
+      std::allocator<_Tp>().deallocate(__p, __k);
+    }
+    template<typename _Up>
+    bool operator==(const CountAlloc<_Up>& __a) const { return n == __a.n; }
+    template<typename _Up>
+    bool operator!=(const CountAlloc<_Up>& __a) const { return n != __a.n; }
+    int* n;
+  };
+  void test_emplace2()
+  {
+    title("test_emplace2() called");
+
+    int n = 0;
+    CountAlloc<TObj> a(&n);
+    shared_ptr_vector<TObj> v1;
+    TObj* r = v1.allocate_back(a, 1, "A");
+    CPPUNIT_ASSERT(1 == n);
+    CPPUNIT_ASSERT(r == v1.front());
+    CPPUNIT_ASSERT_EQUAL(1, r->getN());
+
+    shared_ptr_vector<TObj>::iterator itr = v1.allocate_emplace(v1.begin(), a, 2, "B");
+    CPPUNIT_ASSERT(2 == n);
+    CPPUNIT_ASSERT(2 == v1.size());
+    CPPUNIT_ASSERT(itr == v1.begin());
+    CPPUNIT_ASSERT_EQUAL(2, v1.front()->getN());
+    CPPUNIT_ASSERT_EQUAL(string("A"), v1.back()->getS());
+  }
+  void test_spine1()
+  {
+    title("test_spine1() called");
+
+    CPPUNIT_ASSERT((std::is_same<shared_ptr_vector<int>::iterator, shared_ptr<int>*>::value));
+    typedef shared_ptr_vector<int, CountAlloc<shared_ptr<int> > > counted_vector;
+    CPPUNIT_ASSERT((std::is_same<counted_vector::_spine_type, counted_vector::_vector_type>::value));
+
+    shared_ptr<int> s1 = make_shared<int>(0);
+    shared_ptr_vector<int> v1;
+    v1.push_back(shared_ptr<int>(s1));
+    for (int i = 1; i < 100; ++i)
+      v1.push_back(new int(i));
+    CPPUNIT_ASSERT(100 == v1.size());
+    CPPUNIT_ASSERT_EQUAL(2L, s1.use_count());
+    CPPUNIT_ASSERT(s1.get() == v1[0]);
+    CPPUNIT_ASSERT_EQUAL(99, *v1.back());
+
+    v1.insert(v1.begin() + 1, 3, nullptr);
+    CPPUNIT_ASSERT(nullptr == v1[3]);
+    CPPUNIT_ASSERT_EQUAL(1, *v1[4]);
+    v1.erase(v1.begin() + 1, v1.begin() + 4);
+    CPPUNIT_ASSERT(100 == v1.size());
+    CPPUNIT_ASSERT_EQUAL(1, *v1[1]);
+    v1.erase(v1.begin());
+    CPPUNIT_ASSERT_EQUAL(1L, s1.use_count());
+
+    std::sort(v1.begin(), v1.end(), [](const shared_ptr<int>& a, const shared_ptr<int>& b) { return *b < *a; });
+    CPPUNIT_ASSERT_EQUAL(99, *v1.front());
+    v1.resize(10);
+    v1.shrink_to_fit();
+    CPPUNIT_ASSERT(10 == v1.capacity());
+    CPPUNIT_ASSERT_EQUAL(90, *v1.back());
+
+    int n = 0;
+    counted_vector v2{CountAlloc<shared_ptr<int> >(&n)};
+    v2.push_back(new int(1));
+    CPPUNIT_ASSERT(n > 0);
+    CPPUNIT_ASSERT_EQUAL(1, *v2.front());
+  }
+  void test_reclaim1()
+  {
+    title("test_reclaim1() called");
+
+    shared_ptr_reclaimer r1;
+    weak_ptr<int> w1, w2, w3, w4;
+    {
+      shared_ptr_vector<int> v1{new int(1), new int(2), new int(3), new int(4), new int(5)};
+      v1.set_reclaimer(&r1);
+      CPPUNIT_ASSERT(&r1 == v1.reclaimer());
+      w1 = v1.begin()[0];
+      w2 = v1.begin()[1];
+      w3 = v1.begin()[3];
+      w4 = v1.begin()[4];
+
+      v1.pop_back();
+      v1.erase(v1.begin());
+      CPPUNIT_ASSERT("[ 2 3 4 ]" == to_string(v1));
+      CPPUNIT_ASSERT(2 == r1.pending());
+      CPPUNIT_ASSERT(!w1.expired() && !w4.expired());
+      CPPUNIT_ASSERT(2 == r1.reclaim());
+      CPPUNIT_ASSERT(w1.expired() && w4.expired());
+
+      v1.erase(v1.begin(), v1.begin() + 1);
+      CPPUNIT_ASSERT("[ 3 4 ]" == to_string(v1));
+      CPPUNIT_ASSERT(!w2.expired());
+      v1.clear();
+      CPPUNIT_ASSERT(v1.empty());
+      CPPUNIT_ASSERT(!w3.expired());
+      CPPUNIT_ASSERT(2 == r1.reclaim());
+      CPPUNIT_ASSERT(w2.expired() && w3.expired());
+
+      v1.push_back(new int(6));
+      w1 = v1.begin()[0];
+    }
+    CPPUNIT_ASSERT(!w1.expired());
+    CPPUNIT_ASSERT(1 == r1.reclaim());
+    CPPUNIT_ASSERT(w1.expired());
+
+    shared_ptr_reclaimer r2(std::chrono::microseconds(100));
+    shared_ptr_vector<int> v2{new int(7)};
+    v2.set_reclaimer(&r2);
+    w1 = v2.begin()[0];
+    v2.pop_back();
+    for (int i = 0; i < 10000 && !w1.expired(); ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CPPUNIT_ASSERT(w1.expired());
+    // entries come back from the reclaimer thread while slots go
+    for (int i = 0; i < 1000; ++i)
+      v2.emplace_back(i);
+    while (!v2.empty())
+      v2.pop_back();
+    // a queue entry per slot, reused once reclaimed, and one per spine
+    shared_ptr_reclaimer r3;
+    {
+      shared_ptr_vector<int> v3;
+      for (int i = 0; i < 100; ++i)
+        v3.emplace_back(i);
+      v3.set_reclaimer(&r3);
+      w1 = v3.begin()[10];
+      for (int k = 0; k < 5; ++k)
+      {
+        v3.erase(v3.begin(), v3.begin() + 10);
+        v3.pop_back();
+        CPPUNIT_ASSERT(11 == r3.pending());
+        CPPUNIT_ASSERT(11 == r3.reclaim());
+      }
+      CPPUNIT_ASSERT(w1.expired());
+      CPPUNIT_ASSERT(45 == v3.size());
+      CPPUNIT_ASSERT(50 == *v3.front());
+      v3.pop_back();
+      w1 = v3.begin()[0];
+    }
+    CPPUNIT_ASSERT(2 == r3.pending());
+    CPPUNIT_ASSERT(!w1.expired());
+    CPPUNIT_ASSERT(2 == r3.reclaim());
+    CPPUNIT_ASSERT(w1.expired());
+  }
+  void test_recycle1()
+  {
+    title("test_recycle1() called");
+
+    shared_ptr_vector<TObj> v1;
+    CPPUNIT_ASSERT_EQUAL(false, v1.recycling());
+    v1.enable_recycling(2);
+    CPPUNIT_ASSERT_EQUAL(true, v1.recycling());
+    v1.emplace_back(1, "A");
+    v1.emplace_back(2, "B");
+    v1.emplace_back(3, "C");
+    CPPUNIT_ASSERT(0 == v1.recycle_hits());
+    CPPUNIT_ASSERT(3 == v1.recycle_misses());
+
+    TObj* t3 = v1.back();
+    v1.pop_back();
+    CPPUNIT_ASSERT(1 == v1.recycled());
+    TObj* t4 = v1.emplace_back(4, "D");
+    CPPUNIT_ASSERT(t3 == t4);
+    CPPUNIT_ASSERT_EQUAL(4, t4->getN());
+    CPPUNIT_ASSERT_EQUAL(string("D"), t4->getS());
+    CPPUNIT_ASSERT(1 == v1.recycle_hits());
+    CPPUNIT_ASSERT(0 == v1.recycled());
+
+    // shared elements are not recycled
+    shared_ptr<TObj> s1 = v1.begin()[0];
+    v1.erase(v1.begin());
+    CPPUNIT_ASSERT(0 == v1.recycled());
+    v1.clear();
+    CPPUNIT_ASSERT(2 == v1.recycled());
+    v1.emplace_back();
+    CPPUNIT_ASSERT_EQUAL(0, v1.front()->getN());
+    CPPUNIT_ASSERT(2 == v1.recycle_hits());
+
+    // the free list moves with the elements
+    v1.pop_back();
+    CPPUNIT_ASSERT(2 == v1.recycled());
+    shared_ptr_vector<TObj> v2;
+    v2.enable_recycling(5);
+    v2.emplace_back(5, "E");
+    v2.clear();
+    v2 = std::move(v1);
+    CPPUNIT_ASSERT_EQUAL(true, v2.recycling());
+    CPPUNIT_ASSERT(2 == v2.recycled());
+    CPPUNIT_ASSERT(2 == v2.recycle_hits());
+    CPPUNIT_ASSERT_EQUAL(false, v1.recycling());
+    v2.emplace_back(6, "F");
+    CPPUNIT_ASSERT(1 == v2.recycled());
+    shared_ptr_vector<TObj> v3(std::move(v2));
+    CPPUNIT_ASSERT(1 == v3.recycled());
+    v1 = std::move(v3);
+
+    v1.enable_recycling(0);
+    CPPUNIT_ASSERT(0 == v1.recycled());
+    v1.disable_recycling();
+    CPPUNIT_ASSERT(0 == v1.recycle_hits());
+  }
+  void test_pool1()
+  {
+    title("test_pool1() called");
+
+    shared_ptr_vector<TObj> v1(shared_ptr_vector_pool, 2);
+    CPPUNIT_ASSERT(nullptr != v1.pool());
+    v1.emplace_back(1, "A");
+    v1.emplace_back(2, "B");
+    v1.push_back(TObj(3, "C"));
+    CPPUNIT_ASSERT(3 == v1.size());
+    CPPUNIT_ASSERT(3 == v1.pool()->live());
+    CPPUNIT_ASSERT(2 == v1.pool()->chunks());
+    CPPUNIT_ASSERT_EQUAL(3, v1.back()->getN());
+
+    shared_ptr<TObj> keep(*v1.begin());
+    v1.pop_back();
+    v1.clear();
+    CPPUNIT_ASSERT(1 == v1.pool()->live());
+    v1.emplace_back(4, "D");
+    v1.emplace_back(5, "E");
+    CPPUNIT_ASSERT(2 == v1.pool()->chunks());
+
+    shared_ptr_vector<TObj> v2(v1);
+    CPPUNIT_ASSERT(v2.pool() != v1.pool());
+    CPPUNIT_ASSERT(v1 == v2);
+    v1.release_all();
+    CPPUNIT_ASSERT(v1.empty());
+    CPPUNIT_ASSERT_EQUAL(1, keep->getN());
+    CPPUNIT_ASSERT_EQUAL(5, v2.back()->getN());
+
+    shared_ptr_vector<int> v3(shared_ptr_vector_pool, 4);
+    for (int i = 0; i < 10; ++i)
+      v3.emplace_back(i);
+    CPPUNIT_ASSERT(3 == v3.pool()->chunks());
+    v3.release_all();
+    CPPUNIT_ASSERT(v3.empty());
+    CPPUNIT_ASSERT(0 == v3.pool()->chunks());
+    v3.emplace_back(7);
+    CPPUNIT_ASSERT(7 == *v3.front());
+
+    // elements held elsewhere are not dropped with the chunks
+    shared_ptr_vector<int> v4(shared_ptr_vector_pool, 4);
+    for (int i = 0; i < 6; ++i)
+      v4.emplace_back(i);
+    shared_ptr_vector<int> v5(v4);
+    v4.release_all();
+    CPPUNIT_ASSERT(v4.empty());
+    CPPUNIT_ASSERT("[ 0 1 2 3 4 5 ]" == to_string(v5));
+
+    // nor a block held elsewhere while a slot holds an adopted element
+    v4.emplace_back(1);
+    v4.emplace_back(2);
+    v5 = v4;
+    v4.erase(v4.begin());
+    v4.push_back(new int(3));
+    v5.erase(v5.begin() + 1);
+    CPPUNIT_ASSERT(2 == v4.pool()->live());
+    v4.release_all();
+    CPPUNIT_ASSERT("[ 1 ]" == to_string(v5));
+  }
+  void test_local1()
+  {
+    title("test_local1() called");
+
+    local_shared_ptr_vector<int> v1{new int(3), new int(1), nullptr, new int(2)};
+    v1.emplace_back(0);
+    v1.push_back(5);
+    CPPUNIT_ASSERT(6 == v1.size());
+    CPPUNIT_ASSERT(1 == v1.begin()->use_count());
+
+    local_shared_ptr_vector<int> v2(v1);
+    CPPUNIT_ASSERT(2 == v1.begin()->use_count());
+    CPPUNIT_ASSERT(v1[0] == v2[0]);
+
+    v2.sort();
+    CPPUNIT_ASSERT("[ 0 1 2 3 5 NULL ]" == to_string(v2));
+    CPPUNIT_ASSERT(v2.find_value(2) == v2.begin() + 2);
+    CPPUNIT_ASSERT(v2.find(v1[0]) == v2.begin() + 3);
+
+    v2.clear();
+    CPPUNIT_ASSERT(1 == v1.begin()->use_count());
+
+    local_shared_ptr_vector<TObj> v3(shared_ptr_vector_pool, 8);
+    v3.emplace_back(1, "A");
+    v3.emplace_back(2, "B");
+    CPPUNIT_ASSERT(2 == v3.pool()->live());
+    v3.pop_back();
+    CPPUNIT_ASSERT(1 == v3.pool()->live());
+    CPPUNIT_ASSERT_EQUAL(string("A"), v3.front()->getS());
+  }
+  void test_intrusive1()
+  {
+    title("test_intrusive1() called");
+
+    CPPUNIT_ASSERT(sizeof(shared_ptr_vector<TRef>::shared_data_type) == sizeof(TRef*));
+    CPPUNIT_ASSERT(sizeof(shared_ptr_vector<int>::shared_data_type) == sizeof(shared_ptr<int>));
+
+    TRef* r1 = new TRef(3);
+    TRef* r2 = new TRef(1);
+    shared_ptr_vector<TRef> v1{r1, r2, nullptr};
+    v1.emplace_back(2);
+    CPPUNIT_ASSERT(4 == v1.size());
+    CPPUNIT_ASSERT(r1 == v1[0]);
+    CPPUNIT_ASSERT_EQUAL(1, r1->count());
+
+    shared_ptr_vector<TRef> v2(v1);
+    CPPUNIT_ASSERT_EQUAL(2, r1->count());
+    v2.sort();
+    CPPUNIT_ASSERT("[ 1 2 3 NULL ]" == to_string(v2));
+    CPPUNIT_ASSERT(v2.find(r1) == v2.begin() + 2);
+    CPPUNIT_ASSERT(v2.find_value(TRef(2)) == v2.begin() + 1);
+
+    v2.clear();
+    CPPUNIT_ASSERT_EQUAL(1, r1->count());
+    v1.resize(6, r2);
+    CPPUNIT_ASSERT_EQUAL(3, r2->count());
+  }
   void test_insert1()
   {
     title("test_insert1() called");
@@ -773,6 +1235,36 @@ public:
     CPPUNIT_ASSERT(t2 == v1[4]);
     CPPUNIT_ASSERT_EQUAL(v1[3], v1[4]);
   }
+  void test_insert5()
+  {
+    title("test_insert5() called");
+
+    shared_ptr_vector<int> v1{new int(1), new int(2), new int(3)};
+    vector<int*> v2{new int(4), nullptr, new int(5)};
+    shared_ptr_vector<int>::iterator itr = v1.insert(v1.begin() + 1, v2.begin(), v2.end());
+    CPPUNIT_ASSERT(itr == v1.begin() + 1);
+    CPPUNIT_ASSERT("[ 1 4 NULL 5 2 3 ]" == to_string(v1));
+
+    vector<shared_ptr<int> > v3{make_shared<int>(6), make_shared<int>(7)};
+    v1.insert(v1.begin(), v3.begin(), v3.end());
+    CPPUNIT_ASSERT("[ 6 7 1 4 NULL 5 2 3 ]" == to_string(v1));
+    CPPUNIT_ASSERT_EQUAL(2L, v3[0].use_count());
+    v1.insert(v1.end(), make_move_iterator(v3.begin()), make_move_iterator(v3.end()));
+    CPPUNIT_ASSERT(v3[0] == nullptr);
+    CPPUNIT_ASSERT_EQUAL(2L, v1.begin()->use_count());
+
+    vector<int> v4{8, 9};
+    v1.insert(v1.begin() + 2, v4.begin(), v4.end());
+    CPPUNIT_ASSERT("[ 6 7 8 9 1 4 NULL 5 2 3 6 7 ]" == to_string(v1));
+
+    istringstream is("10 11 12");
+    itr = v1.insert(v1.begin() + 1, istream_iterator<int>(is), istream_iterator<int>());
+    CPPUNIT_ASSERT(itr == v1.begin() + 1);
+    CPPUNIT_ASSERT("[ 6 10 11 12 7 8 9 1 4 NULL 5 2 3 6 7 ]" == to_string(v1));
+
+    v1.insert(v1.begin() + 3, {new int(13)});
+    CPPUNIT_ASSERT("[ 6 10 11 13 12 7 8 9 1 4 NULL 5 2 3 6 7 ]" == to_string(v1));
+  }
   void test_erase1()
   {
     title("test_erase1() called");
@@ -881,6 +1373,41 @@ public:
     CPPUNIT_ASSERT(0 == v2.size());
   }
 
+  void test_splice1()
+  {
+    title("test_splice1() called");
+
+    shared_ptr_vector<int> v1{new int(1), new int(2), new int(3)};
+    shared_ptr_vector<int> v2{new int(4), new int(5), nullptr, new int(6)};
+    const int* p5 = v2[1];
+    v2.enable_index();
+
+    shared_ptr_vector<int>::iterator itr = v1.splice(v1.begin() + 1, v2, v2.begin() + 1, v2.begin() + 3);
+    CPPUNIT_ASSERT(itr == v1.begin() + 1);
+    CPPUNIT_ASSERT("[ 1 5 NULL 2 3 ]" == to_string(v1));
+    CPPUNIT_ASSERT("[ 4 6 ]" == to_string(v2));
+    CPPUNIT_ASSERT(p5 == v1[1]);
+    CPPUNIT_ASSERT_EQUAL(1L, itr->use_count());
+    CPPUNIT_ASSERT(v2.find_value(5) == v2.end());
+    CPPUNIT_ASSERT(v2.find_value(6) == v2.begin() + 1);
+
+    itr = v1.splice(v1.end(), v1, v1.begin(), v1.begin() + 2);
+    CPPUNIT_ASSERT(itr == v1.begin() + 3);
+    CPPUNIT_ASSERT("[ NULL 2 3 1 5 ]" == to_string(v1));
+    itr = v1.splice(v1.begin(), v1, v1.begin() + 3, v1.end());
+    CPPUNIT_ASSERT(itr == v1.begin());
+    CPPUNIT_ASSERT("[ 1 5 NULL 2 3 ]" == to_string(v1));
+
+    v1.splice(v1.end(), v2);
+    CPPUNIT_ASSERT(v2.empty());
+    CPPUNIT_ASSERT("[ 1 5 NULL 2 3 4 6 ]" == to_string(v1));
+
+    shared_ptr_vector<int> v3 = v1.extract(v1.begin() + 2, v1.begin() + 5);
+    CPPUNIT_ASSERT("[ NULL 2 3 ]" == to_string(v3));
+    CPPUNIT_ASSERT("[ 1 5 4 6 ]" == to_string(v1));
+    CPPUNIT_ASSERT_EQUAL(1L, (v3.begin() + 1)->use_count());
+  }
+
   void test_pop1()
   {
     title("test_pop1() called");
@@ -1155,6 +1682,113 @@ public:
     cout << "after sort: v2=" << v2 << endl;
     */
   }
+  void test_sort4()
+  {
+    title("test_sort4() called");
+
+    shared_ptr_vector<TObj> v1;
+    v1.emplace_back(5, "H");
+    v1.push_back(nullptr);
+    v1.emplace_back(2, "B");
+    v1.emplace_back(3, "D");
+    v1.emplace_back(3, "C");
+    v1.emplace_back(1, "A");
+    TObj* t1 = v1[0];
+    cout << "before sort: v1=" << v1 << endl;
+
+    v1.sort_by_key([](const TObj& a) { return a.getN(); });
+    cout << "after sort: v1=" << v1 << endl;
+    CPPUNIT_ASSERT("[ (1,A) (2,B) (3,D) (3,C) (5,H) NULL ]" == to_string(v1));
+    CPPUNIT_ASSERT(t1 == v1[4]);
+
+    v1.sort_by_key([](const TObj& a) { return a.getS(); }, greater<string>());
+    CPPUNIT_ASSERT("[ (5,H) (3,D) (3,C) (2,B) (1,A) NULL ]" == to_string(v1));
+  }
+  void test_sort5()
+  {
+    title("test_sort5() called");
+
+    shared_ptr_vector<int> v1;
+    for (int i = 0; i < 1000; ++i)
+    {
+      if (i % 97 == 0)
+        v1.push_back(nullptr);
+      else
+        v1.emplace_back((i * 7919) % 101);
+    }
+    shared_ptr_vector<int> v2(v1);
+    shared_ptr_vector<int> v3(v1);
+    stable_sort(v1.begin(), v1.end(), shared_ptr_vector<int>::shared_ptr_value_less());
+
+    v2.sort(shared_ptr_vector_parallel(4, 10));
+    sort(shared_ptr_vector_parallel(3, 1), v3);
+    CPPUNIT_ASSERT(equal(v1.begin(), v1.end(), v2.begin()));
+    CPPUNIT_ASSERT(equal(v1.begin(), v1.end(), v3.begin()));
+    CPPUNIT_ASSERT(nullptr == v2.back());
+
+    // the serial sorts give the same slots as the parallel one
+    shared_ptr_vector<int> v4;
+    for (int i = 0; i < 200; ++i)
+      v4.emplace_back(i % 3);
+    shared_ptr_vector<int> v5(v4);
+    shared_ptr_vector<int> v6(v4);
+    v4.sort();
+    sort(v5);
+    v6.sort(shared_ptr_vector_parallel(4, 10));
+    for (size_t i = 0; i < v4.size(); ++i)
+    {
+      CPPUNIT_ASSERT(v6[i] == v4[i]);
+      CPPUNIT_ASSERT(v6[i] == v5[i]);
+    }
+  }
+  void test_find4()
+  {
+    title("test_find4() called");
+
+    shared_ptr_vector<int> v1;
+    for (int i = 0; i < 1000; ++i)
+      v1.emplace_back(i % 300);
+    v1.at(5, nullptr);
+    shared_ptr_vector_parallel par(4, 10);
+
+    CPPUNIT_ASSERT(v1.find(par, v1[700]) == v1.begin() + 700);
+    CPPUNIT_ASSERT(v1.find(par, nullptr) == v1.begin() + 5);
+    CPPUNIT_ASSERT(v1.find_value(par, 250) == v1.begin() + 250);
+    CPPUNIT_ASSERT(v1.find_value(par, 250) == v1.find_value(250));
+    CPPUNIT_ASSERT(v1.find_value(par, 300) == v1.end());
+    CPPUNIT_ASSERT(v1.find_value(par, v1[901]) == v1.begin() + 1);
+    CPPUNIT_ASSERT(v1.find_if_value(par, [](const int& a) { return a > 298; }) == v1.begin() + 299);
+    const shared_ptr_vector<int>& c1 = v1;
+    CPPUNIT_ASSERT(c1.find_value(par, 5) == c1.begin() + 305);
+  }
+  void test_sort6()
+  {
+    title("test_sort6() called");
+
+    shared_ptr_vector<int> v1;
+    v1.push_back(nullptr);
+    v1.push_back(new int(2));
+    v1.push_back(new int(-5));
+    v1.push_back(new int(300));
+    v1.push_back(new int(-1));
+    v1.push_back(new int(4));
+    v1.radix_sort();
+    CPPUNIT_ASSERT("[ -5 -1 2 4 300 NULL ]" == to_string(v1));
+
+    shared_ptr_vector<double> v2{new double(1.5), new double(-0.25), nullptr, new double(-3), new double(0)};
+    v2.radix_sort();
+    CPPUNIT_ASSERT("[ -3 -0.25 0 1.5 NULL ]" == to_string(v2));
+
+    shared_ptr_vector<TObj> v3;
+    v3.emplace_back(5, "H");
+    v3.emplace_back(2, "B");
+    v3.emplace_back(1000000, "D");
+    v3.push_back(nullptr);
+    v3.emplace_back(2, "C");
+    v3.emplace_back(1, "A");
+    v3.radix_sort([](const TObj& a) { return uint64_t(a.getN()); });
+    CPPUNIT_ASSERT("[ (1,A) (2,B) (2,C) (5,H) (1000000,D) NULL ]" == to_string(v3));
+  }
   void test_find1()
   {
     title("test_find1() called");
@@ -1307,6 +1941,548 @@ public:
     std::cout << temp << std::endl;
   }
 
+  void test_index1()
+  {
+    title("test_index1() called");
+
+    shared_ptr_vector<int> v1{new int(5), new int(3), nullptr, new int(3)};
+    int* i1 = v1[1];
+    CPPUNIT_ASSERT_EQUAL(false, v1.indexed());
+    CPPUNIT_ASSERT(0 == v1.index_memory());
+    v1.enable_index();
+    CPPUNIT_ASSERT_EQUAL(true, v1.indexed());
+
+    CPPUNIT_ASSERT(v1.find_value(3) == v1.begin() + 1);
+    CPPUNIT_ASSERT(v1.find(i1) == v1.begin() + 1);
+    CPPUNIT_ASSERT(v1.find(nullptr) == v1.begin() + 2);
+    CPPUNIT_ASSERT(v1.find_value(7) == v1.end());
+    CPPUNIT_ASSERT(v1.index_memory() > 0);
+
+    v1.push_back(new int(7));
+    v1.emplace_back(8);
+    CPPUNIT_ASSERT(v1.find_value(7) == v1.begin() + 4);
+    CPPUNIT_ASSERT(v1.find_value(8) == v1.begin() + 5);
+    v1.pop_back();
+    CPPUNIT_ASSERT(v1.find_value(8) == v1.end());
+
+    v1.erase(v1.begin() + 1);
+    CPPUNIT_ASSERT(v1.find(i1) == v1.end());
+    CPPUNIT_ASSERT(v1.find_value(3) == v1.begin() + 2);
+    int* i2 = new int(4);
+    v1.insert(v1.begin(), i2);
+    CPPUNIT_ASSERT(v1.find(i2) == v1.begin());
+    CPPUNIT_ASSERT(v1.find_value(4) == v1.begin());
+    v1.at(0, new int(9));
+    CPPUNIT_ASSERT(v1.find_value(9) == v1.begin());
+    CPPUNIT_ASSERT(v1.find_value(3) == v1.begin() + 3);
+
+    v1.sort();
+    CPPUNIT_ASSERT("[ 3 5 7 9 NULL ]" == to_string(v1));
+    CPPUNIT_ASSERT(v1.find_value(9) == v1.begin() + 3);
+
+    shared_ptr_vector<int> v2{new int(1)};
+    v1.swap(v2);
+    CPPUNIT_ASSERT_EQUAL(false, v1.indexed());
+    CPPUNIT_ASSERT(v2.find_value(5) == v2.begin() + 1);
+    v2.erase(v2.begin() + 3, v2.end());
+    CPPUNIT_ASSERT(v2.find_value(9) == v2.end());
+
+    shared_ptr_vector<TObj> v3;
+    v3.emplace_back(1, "A");
+    v3.emplace_back(2, "B");
+    v3.enable_index();
+    CPPUNIT_ASSERT(v3.find(v3[1]) == v3.begin() + 1);
+    CPPUNIT_ASSERT(v3.find_value(TObj(2, "B")) == v3.begin() + 1);
+
+    // the index goes with a move, and a moved-from vector can be reused
+    int* i3 = v2[1];
+    shared_ptr_vector<int> v4(std::move(v2), shared_ptr_vector<int>::allocator_type());
+    CPPUNIT_ASSERT_EQUAL(true, v4.indexed());
+    CPPUNIT_ASSERT(v4.find(i3) == v4.begin() + 1);
+    v2 = std::move(v4);
+    CPPUNIT_ASSERT(v2.find(i3) == v2.begin() + 1);
+    CPPUNIT_ASSERT(v4.find(i3) == v4.end());
+    v4.enable_index();
+    v4.push_back(new int(6));
+    v4 = std::move(v2);
+    CPPUNIT_ASSERT(v4.find_value(5) == v4.begin() + 1);
+    CPPUNIT_ASSERT(v2.find(i3) == v2.end());
+    v2.push_back(i3 = new int(6));
+    CPPUNIT_ASSERT(v2.find(i3) == v2.begin());
+    CPPUNIT_ASSERT(v2.find_value(5) == v2.end());
+
+    // the free sort keeps the index too
+    shared_ptr_vector<int> v5{new int(5), new int(4), new int(3), new int(2), new int(1)};
+    v5.enable_index();
+    int* i5 = v5[0];
+    CPPUNIT_ASSERT(v5.find(i5) == v5.begin());
+    sort(v5);
+    CPPUNIT_ASSERT(v5.find(i5) == v5.begin() + 4);
+    CPPUNIT_ASSERT(v5.find_value(1) == v5.begin());
+  }
+
+  void test_index2()
+  {
+    title("test_index2() called");
+
+    // readers of a snapshot whose index is stale rebuild it once
+    cow_shared_ptr_vector<int> v1;
+    v1.write().enable_index();
+    for (int i = 0; i < 1000; ++i)
+      v1.write().push_back(new int(i));
+    v1.write().insert(v1.write().begin(), new int(-1));
+    v1.publish();
+    cow_shared_ptr_vector<int>::snapshot_type s1 = v1.load();
+    std::atomic<int> misses(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+      readers.emplace_back([&s1, &misses, t]
+                           {
+                             for (int i = t; i < 1000; i += 4)
+                             {
+                               if (s1->find_value(i) != s1->begin() + i + 1 || s1->find(const_cast<int*>((*s1)[i])) != s1->begin() + i)
+                                 ++misses;
+                             }
+                           });
+    for (auto& r : readers)
+      r.join();
+    CPPUNIT_ASSERT(0 == misses.load());
+
+    // and so do the readers of a shard
+    sharded_shared_ptr_vector<int, 2> v2;
+    for (int i = 0; i < 1000; ++i)
+      v2.write(i % 2, [i](shared_ptr_vector<int>& l) { l.push_back(new int(i)); });
+    v2.write(0, [](shared_ptr_vector<int>& l) { l.enable_index(); });
+    readers.clear();
+    for (int t = 0; t < 4; ++t)
+      readers.emplace_back([&v2, &misses, t]
+                           {
+                             for (int i = t; i < 1000; i += 4)
+                             {
+                               if (i % 2)
+                                 continue;
+                               if (!v2.read(0, [i](const shared_ptr_vector<int>& l) { return l.find_value(i) == l.begin() + i / 2; }))
+                                 ++misses;
+                             }
+                           });
+    for (auto& r : readers)
+      r.join();
+    CPPUNIT_ASSERT(0 == misses.load());
+  }
+
+  void test_sorted1()
+  {
+    title("test_sorted1() called");
+
+    sorted_shared_ptr_vector<int> v1{new int(5), nullptr, new int(3), new int(9)};
+    CPPUNIT_ASSERT("[ 3 5 9 NULL ]" == to_string(v1));
+
+    int* i1 = new int(5);
+    auto p = v1.insert_sorted(i1);
+    CPPUNIT_ASSERT(p == v1.begin() + 2);
+    p = v1.emplace_sorted(4);
+    CPPUNIT_ASSERT(p == v1.begin() + 1);
+    p = v1.insert_sorted(nullptr);
+    CPPUNIT_ASSERT(p == v1.begin() + 6);
+    CPPUNIT_ASSERT("[ 3 4 5 5 9 NULL NULL ]" == to_string(v1));
+
+    CPPUNIT_ASSERT(v1.find_value(5) == v1.begin() + 2);
+    CPPUNIT_ASSERT(v1.find_value(6) == v1.end());
+    CPPUNIT_ASSERT(v1.find_value(10) == v1.end());
+    CPPUNIT_ASSERT(v1.find(i1) == v1.begin() + 3);
+    CPPUNIT_ASSERT(v1.find(nullptr) == v1.begin() + 5);
+    CPPUNIT_ASSERT(v1.lower_bound(6) == v1.begin() + 4);
+    CPPUNIT_ASSERT(v1.upper_bound(9) == v1.begin() + 5);
+    auto r = v1.equal_range(5);
+    CPPUNIT_ASSERT(r.first == v1.begin() + 2 && r.second == v1.begin() + 4);
+
+    int* batch[] = {new int(8), new int(1), new int(5), nullptr};
+    v1.merge_sorted(batch, batch + 4);
+    CPPUNIT_ASSERT("[ 1 3 4 5 5 5 8 9 NULL NULL NULL ]" == to_string(v1));
+    CPPUNIT_ASSERT(v1.find(batch[2]) == v1.begin() + 5);
+
+    shared_ptr_vector<int> v2{new int(2), new int(7)};
+    v1.merge_sorted(v2);
+    CPPUNIT_ASSERT("[ 1 2 3 4 5 5 5 7 8 9 NULL NULL NULL ]" == to_string(v1));
+    CPPUNIT_ASSERT(v1[1] == v2[0]);
+
+    v1.erase(v1.lower_bound_null(), v1.end());
+    shared_ptr_vector<int> v3 = v1.release();
+    CPPUNIT_ASSERT(v1.empty());
+    CPPUNIT_ASSERT("[ 1 2 3 4 5 5 5 7 8 9 ]" == to_string(v3));
+
+    sorted_shared_ptr_vector<int> v4(shared_ptr_vector<int>{new int(2), nullptr, new int(1)});
+    CPPUNIT_ASSERT("[ 1 2 NULL ]" == to_string(v4));
+
+    // into an empty container, and a value greater than every element
+    sorted_shared_ptr_vector<int> v5;
+    p = v5.emplace_sorted(4);
+    CPPUNIT_ASSERT(p == v5.begin());
+    p = v5.emplace_sorted(7);
+    CPPUNIT_ASSERT(p == v5.begin() + 1);
+    p = v5.emplace_sorted(7);
+    CPPUNIT_ASSERT(p == v5.begin() + 2);
+    v5.insert_sorted(nullptr);
+    p = v5.emplace_sorted(9);
+    CPPUNIT_ASSERT(p == v5.begin() + 3);
+    CPPUNIT_ASSERT("[ 4 7 7 9 NULL ]" == to_string(v5));
+  }
+
+  void test_concurrent1()
+  {
+    title("test_concurrent1() called");
+
+    concurrent_shared_ptr_vector<int, shared_ptr_policy<int>, 16> v1;
+    const int n = 5000;
+    std::atomic<bool> done(false);
+    std::thread reader([&]
+                       {
+                         while (!done.load())
+                         {
+                           for (auto i = v1.begin(), e = v1.end(); i != e; ++i)
+                             CPPUNIT_ASSERT(*i != nullptr);
+                         }
+                       });
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t)
+      writers.emplace_back([&v1, t]
+                           {
+                             for (int i = 0; i < n; ++i)
+                             {
+                               if (i % 2)
+                                 v1.emplace_back(t * n + i);
+                               else
+                                 v1.push_back(new int(t * n + i));
+                             }
+                           });
+    for (auto& w : writers)
+      w.join();
+    done.store(true);
+    reader.join();
+
+    CPPUNIT_ASSERT(4 * n == (int)v1.size());
+    std::vector<bool> seen(4 * n);
+    for (size_t i = 0; i < v1.size(); ++i)
+      seen[*v1[i]] = true;
+    CPPUNIT_ASSERT(std::find(seen.begin(), seen.end(), false) == seen.end());
+    bool thrown = false;
+    try { v1.at(4 * n); } catch (const std::out_of_range&) { thrown = true; }
+    CPPUNIT_ASSERT(thrown);
+
+    shared_ptr_vector<int> v2 = v1.to_shared_ptr_vector();
+    CPPUNIT_ASSERT(4 * n == (int)v2.size());
+    CPPUNIT_ASSERT(v2[7] == v1[7]);
+    v1.clear();
+    CPPUNIT_ASSERT(v1.empty());
+    CPPUNIT_ASSERT(0 == v1.push_back(new int(1)));
+  }
+
+  void test_snapshot1()
+  {
+    title("test_snapshot1() called");
+
+    cow_shared_ptr_vector<int> v1;
+    v1.write().push_back(new int(1));
+    v1.write().push_back(new int(2));
+    CPPUNIT_ASSERT(!v1.load());
+
+    // a snapshot shares the slots until the next write
+    cow_shared_ptr_vector<int>::snapshot_type s1 = v1.snapshot();
+    CPPUNIT_ASSERT(&v1.read() == s1.get());
+    CPPUNIT_ASSERT(v1.shared());
+    shared_ptr_vector<int>& w = v1.write();
+    CPPUNIT_ASSERT(&w != s1.get());
+    CPPUNIT_ASSERT(&w == &v1.write());
+    w.push_back(new int(3));
+    w.at(0, new int(10));
+    CPPUNIT_ASSERT(2 == s1->size());
+    CPPUNIT_ASSERT(1 == *(*s1)[0]);
+    CPPUNIT_ASSERT(3 == v1.read().size());
+    CPPUNIT_ASSERT((*s1)[1] == v1.read()[1]);
+    CPPUNIT_ASSERT(10 == *v1.read()[0]);
+
+    // readers see the published versions only
+    v1.publish();
+    const int n = 200;
+    std::atomic<bool> done(false);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; ++t)
+      readers.emplace_back([&v1, &done]
+                           {
+                             while (!done.load())
+                             {
+                               cow_shared_ptr_vector<int>::snapshot_type s = v1.load();
+                               for (size_t i = 0; i < s->size(); ++i)
+                                 CPPUNIT_ASSERT((int)i + 1 == *(*s)[i] || i == 0);
+                             }
+                           });
+    for (int i = 4; i < n; ++i)
+    {
+      v1.write().push_back(new int(i));
+      v1.publish();
+    }
+    done.store(true);
+    for (auto& r : readers)
+      r.join();
+    CPPUNIT_ASSERT(n - 1 == (int)v1.load()->size());
+    CPPUNIT_ASSERT(2 == s1->size());
+  }
+
+  void test_sharded1()
+  {
+    title("test_sharded1() called");
+
+    sharded_shared_ptr_vector<int, 4> v1;
+    const int n = 1000;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t)
+      writers.emplace_back([&v1, t]
+                           {
+                             for (int i = t; i < n; i += 4)
+                             {
+                               CPPUNIT_ASSERT(v1.shard_of(n - i) == v1.emplace_back(n - i));
+                               v1.find_value(n - i);
+                             }
+                           });
+    for (auto& w : writers)
+      w.join();
+    CPPUNIT_ASSERT(n == (int)v1.size());
+    CPPUNIT_ASSERT(7 == *v1.find_value(7));
+    CPPUNIT_ASSERT(!v1.find_value(n + 1));
+    CPPUNIT_ASSERT(v1.erase_value(7));
+    CPPUNIT_ASSERT(!v1.erase_value(7));
+    CPPUNIT_ASSERT(n - 1 == (int)v1.size());
+
+    // a value out of its shard is found by the parallel search only
+    v1.write((v1.shard_of(7) + 1) % 4, [](auto& s) { s.push_back(new int(7)); });
+    CPPUNIT_ASSERT(!v1.find_value(7));
+    shared_ptr_vector_parallel par(3);
+    CPPUNIT_ASSERT(7 == *v1.find_value(par, 7));
+
+    std::atomic<long> sum(0);
+    v1.for_each(par, [&sum](const std::shared_ptr<int>& p) { sum += *p; });
+    CPPUNIT_ASSERT((long)n * (n + 1) / 2 == sum.load());
+
+    v1.sort(par);
+    CPPUNIT_ASSERT(0 < v1.read(0, [](const auto& s) { return s.size(); }));
+    {
+      auto view = v1.sorted();
+      CPPUNIT_ASSERT(n == (int)view.size());
+      int prev = 0, k = 0;
+      for (auto i = view.begin(); i != view.end(); ++i, ++k)
+      {
+        CPPUNIT_ASSERT(prev <= **i);
+        prev = **i;
+      }
+      CPPUNIT_ASSERT(n == k);
+      CPPUNIT_ASSERT(n == prev);
+    }
+    bool thrown = false;
+    try { v1.at(n); } catch (const std::out_of_range&) { thrown = true; }
+    CPPUNIT_ASSERT(thrown);
+    CPPUNIT_ASSERT(v1.at(n - 1));
+    v1.clear();
+    CPPUNIT_ASSERT(v1.empty());
+
+    // equal elements keep their order within a shard
+    sharded_shared_ptr_vector<int, 2> v2;
+    std::vector<const int*> order;
+    for (int i = 0; i < 200; ++i)
+      v2.write(0, [i, &order](auto& s) { s.push_back(new int(i % 3)); order.push_back(s.back()); });
+    std::stable_sort(order.begin(), order.end(), [](const int* a, const int* b) { return *a < *b; });
+    v2.sort(par);
+    CPPUNIT_ASSERT(v2.read(0, [&order](const auto& s) { return std::equal(s.begin(), s.end(), order.begin(),
+                                                                          [](const std::shared_ptr<int>& a, const int* b) { return a.get() == b; }); }));
+  }
+
+  void test_atomic1()
+  {
+    title("test_atomic1() called");
+
+    shared_ptr_vector<int> v0 = { new int(0), nullptr };
+    atomic_shared_ptr_vector<int> v1(v0);
+    CPPUNIT_ASSERT(2 == v1.size());
+    CPPUNIT_ASSERT(v1.load(0).get() == v0[0]);
+    CPPUNIT_ASSERT(!v1.load(1));
+
+    std::shared_ptr<int> e;
+    CPPUNIT_ASSERT(v1.compare_exchange(1, e, std::make_shared<int>(1)));
+    CPPUNIT_ASSERT(1 == *v1.load(1));
+    CPPUNIT_ASSERT(!v1.compare_exchange(1, e, std::make_shared<int>(2)));
+    CPPUNIT_ASSERT(1 == *e);
+    CPPUNIT_ASSERT(1 == *v1.exchange(1, std::make_shared<int>(3)));
+    v1.store(1, nullptr);
+    CPPUNIT_ASSERT(!v1.load(1));
+
+    // readers always see a whole element while a writer swaps them
+    const int n = 20000;
+    std::atomic<bool> done(false);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t)
+      readers.emplace_back([&v1, &done]
+                           {
+                             int last = 0;
+                             while (!done.load())
+                             {
+                               std::shared_ptr<int> p = v1.load(0);
+                               CPPUNIT_ASSERT(p && *p >= last);
+                               last = *p;
+                             }
+                           });
+    for (int i = 1; i <= n; ++i)
+      v1.store(0, new int(i));
+    done.store(true);
+    for (auto& r : readers)
+      r.join();
+    CPPUNIT_ASSERT(n == *v1.load(0));
+    CPPUNIT_ASSERT(0 == v1.reclaim());
+    CPPUNIT_ASSERT(0 == *v0[0]);
+  }
+
+  void test_serialize1()
+  {
+    title("test_serialize1() called");
+
+    shared_ptr_vector<TObj> v1;
+    v1.push_back(new TObj(1, "one"));
+    v1.push_back(nullptr);
+    v1.push_back(new TObj(2, "two"));
+    v1.push_back(std::shared_ptr<TObj>(*v1.begin()));
+    std::stringstream ss;
+    v1.serialize(ss);
+
+    shared_ptr_vector<TObj> v2 = { new TObj(9, "nine") };
+    v2.deserialize(ss);
+    CPPUNIT_ASSERT(to_string(v1) == to_string(v2));
+    CPPUNIT_ASSERT(nullptr == v2[1]);
+    CPPUNIT_ASSERT(v2[0] == v2[3]);
+    CPPUNIT_ASSERT(v2[0] != v1[0]);
+    CPPUNIT_ASSERT(2 == v2.begin()->use_count());
+
+    shared_ptr_vector<int> v3 = { new int(1), new int(2), nullptr };
+    std::stringstream ss3;
+    v3.serialize(ss3);
+    std::string bytes = ss3.str();
+    std::stringstream cut(bytes.substr(0, bytes.size() - 2));
+    shared_ptr_vector<int> v4 = { new int(7) };
+    bool thrown = false;
+    try { v4.deserialize(cut); } catch (const std::runtime_error&) { thrown = true; }
+    CPPUNIT_ASSERT(thrown);
+    CPPUNIT_ASSERT("[ 7 ]" == to_string(v4));
+    std::stringstream whole(bytes);
+    v4.deserialize(whole);
+    CPPUNIT_ASSERT(to_string(v3) == to_string(v4));
+
+    // a count far beyond the input is not reserved
+    std::stringstream huge(std::string("SPV1\xff\xff\xff\xff\xff\xff\xff\x3f", 12));
+    thrown = false;
+    try { v4.deserialize(huge); } catch (const std::runtime_error&) { thrown = true; }
+    CPPUNIT_ASSERT(thrown);
+    CPPUNIT_ASSERT(to_string(v3) == to_string(v4));
+  }
+
+  void test_mapped1()
+  {
+    title("test_mapped1() called");
+
+    shared_ptr_vector<double> v1 = { new double(1.5), nullptr, new double(2.5) };
+    v1.push_back(std::shared_ptr<double>(*v1.begin()));
+    const std::string path = "ut_mapped1.spvm";
+    {
+      std::ofstream os(path, std::ios::binary);
+      mapped_shared_ptr_vector<double>::write(os, v1);
+    }
+
+    std::shared_ptr<const double> keep;
+    {
+      mapped_shared_ptr_vector<double> m1(path.c_str());
+      CPPUNIT_ASSERT(4 == m1.size());
+      CPPUNIT_ASSERT(2 == m1.count());
+      CPPUNIT_ASSERT(1.5 == *m1[0]);
+      CPPUNIT_ASSERT(nullptr == m1[1]);
+      CPPUNIT_ASSERT(m1[0] == m1[3]);
+      CPPUNIT_ASSERT(m1.begin() + 2 == m1.find_value(2.5));
+      CPPUNIT_ASSERT(m1.end() == m1.find_value(9.5));
+      CPPUNIT_ASSERT(m1.begin() + 1 == m1.find(nullptr));
+      CPPUNIT_ASSERT(4 == std::distance(m1.begin(), m1.end()));
+
+      keep = m1.slot(2);
+      std::shared_ptr<const double> other = m1.slot(0);
+      CPPUNIT_ASSERT(!other.owner_before(keep) && !keep.owner_before(other));
+      CPPUNIT_ASSERT(!m1.slot(1));
+
+      shared_ptr_vector<double> v2 = m1.to_shared_ptr_vector();
+      CPPUNIT_ASSERT(to_string(v1) == to_string(v2));
+      CPPUNIT_ASSERT(v2[0] == v2[3]);
+
+      bool thrown = false;
+      try { m1.at(4); } catch (const std::out_of_range&) { thrown = true; }
+      CPPUNIT_ASSERT(thrown);
+    }
+    CPPUNIT_ASSERT(2.5 == *keep);
+
+    bool thrown = false;
+    try { mapped_shared_ptr_vector<int> m2(path.c_str()); } catch (const std::runtime_error&) { thrown = true; }
+    CPPUNIT_ASSERT(thrown);
+
+    // an entry past the elements is refused when the file is opened
+    {
+      std::fstream fs(path, std::ios::in | std::ios::out | std::ios::binary);
+      const std::uint64_t bad = 3;
+      fs.seekp(32 + 2 * sizeof(std::uint64_t));   // 32-byte header, slot 2
+      fs.write(reinterpret_cast<const char*>(&bad), sizeof(bad));
+    }
+    thrown = false;
+    try { mapped_shared_ptr_vector<double> m4(path.c_str()); } catch (const std::runtime_error&) { thrown = true; }
+    CPPUNIT_ASSERT(thrown);
+    std::remove(path.c_str());
+    thrown = false;
+    try { mapped_shared_ptr_vector<double> m3(path.c_str()); } catch (const std::system_error&) { thrown = true; }
+    CPPUNIT_ASSERT(thrown);
+  }
+
+  void test_format1()
+  {
+    title("test_format1() called");
+
+    shared_ptr_vector<int> v1 = { new int(12), nullptr, new int(-3) };
+    CPPUNIT_ASSERT(std::string("[ 12 NULL -3 ]") == to_string(v1));
+    CPPUNIT_ASSERT(14 == formatted_size(v1));
+    char buf[14];
+    CPPUNIT_ASSERT(buf + 14 == format_to(buf, v1));
+    CPPUNIT_ASSERT(std::string("[ 12 NULL -3 ]") == std::string(buf, 14));
+
+    shared_ptr_vector<double> v2 = { new double(0.5), new double(1.0 / 3), new double(1e7) };
+    std::ostringstream os;
+    os << v2;
+    CPPUNIT_ASSERT(std::string("[ 0.5 0.333333 1e+07 ]") == os.str());
+    CPPUNIT_ASSERT(os.str() == to_string(v2));
+    std::ostringstream os2;
+    os2 << std::fixed << v2;
+    CPPUNIT_ASSERT(std::string("[ 0.500000 0.333333 10000000.000000 ]") == os2.str());
+
+    shared_ptr_vector<long> v3;
+    std::string expect = "[ ";
+    for (long i = 0; i < 10000; ++i)
+    {
+      v3.push_back(i * 7919);
+      expect += std::to_string(i * 7919) + " ";
+    }
+    expect += "]";
+    std::string out;
+    int chunks = 0;
+    format_chunked(v3, [&](const char* p, size_t n) { out.append(p, n); ++chunks; });
+    CPPUNIT_ASSERT(expect == out);
+    CPPUNIT_ASSERT(chunks > 1);
+    CPPUNIT_ASSERT(expect == to_string(v3));
+
+    shared_ptr_vector<TObj> v4 = { new TObj(1, "one"), nullptr };
+    std::string out4;
+    format_to(std::back_inserter(out4), v4);
+    CPPUNIT_ASSERT(std::string("[ (1,one) NULL ]") == out4);
+    CPPUNIT_ASSERT(out4 == to_string(v4));
+  }
+
   void test_iter1()
   {
     title("test_iter1() called");
@@ -1364,13 +2540,24 @@ public:
     s->addTest(new CppUnit::TestCaller<Tests>("test_emplaceback1", &Tests::test_emplaceback1));
     s->addTest(new CppUnit::TestCaller<Tests>("test_emplaceback2", &Tests::test_emplaceback2));
     s->addTest(new CppUnit::TestCaller<Tests>("test_emplace1", &Tests::test_emplace1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_push3", &Tests::test_push3));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_adopt1", &Tests::test_adopt1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_emplace2", &Tests::test_emplace2));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_spine1", &Tests::test_spine1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_reclaim1", &Tests::test_reclaim1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_recycle1", &Tests::test_recycle1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_pool1", &Tests::test_pool1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_local1", &Tests::test_local1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_intrusive1", &Tests::test_intrusive1));
     s->addTest(new CppUnit::TestCaller<Tests>("test_insert1", &Tests::test_insert1));
     s->addTest(new CppUnit::TestCaller<Tests>("test_insert2", &Tests::test_insert2));
     s->addTest(new CppUnit::TestCaller<Tests>("test_insert3", &Tests::test_insert3));
     s->addTest(new CppUnit::TestCaller<Tests>("test_insert4", &Tests::test_insert4));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_insert5", &Tests::test_insert5));
     s->addTest(new CppUnit::TestCaller<Tests>("test_erase1", &Tests::test_erase1));
     s->addTest(new CppUnit::TestCaller<Tests>("test_erase2", &Tests::test_erase2));
     s->addTest(new CppUnit::TestCaller<Tests>("test_swap", &Tests::test_swap));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_splice1", &Tests::test_splice1));
     s->addTest(new CppUnit::TestCaller<Tests>("test_pop1", &Tests::test_pop1));
     s->addTest(new CppUnit::TestCaller<Tests>("test_eq", &Tests::test_eq));
     s->addTest(new CppUnit::TestCaller<Tests>("test_less", &Tests::test_less));
@@ -1379,9 +2566,23 @@ public:
     s->addTest(new CppUnit::TestCaller<Tests>("test_sort1", &Tests::test_sort1));
     s->addTest(new CppUnit::TestCaller<Tests>("test_sort2", &Tests::test_sort2));
     s->addTest(new CppUnit::TestCaller<Tests>("test_sort3", &Tests::test_sort3));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_sort4", &Tests::test_sort4));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_sort5", &Tests::test_sort5));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_sort6", &Tests::test_sort6));
     s->addTest(new CppUnit::TestCaller<Tests>("test_find1", &Tests::test_find1));
     s->addTest(new CppUnit::TestCaller<Tests>("test_find2", &Tests::test_find2));
     s->addTest(new CppUnit::TestCaller<Tests>("test_find3", &Tests::test_find3));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_find4", &Tests::test_find4));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_index1", &Tests::test_index1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_index2", &Tests::test_index2));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_sorted1", &Tests::test_sorted1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_concurrent1", &Tests::test_concurrent1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_snapshot1", &Tests::test_snapshot1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_sharded1", &Tests::test_sharded1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_atomic1", &Tests::test_atomic1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_serialize1", &Tests::test_serialize1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_mapped1", &Tests::test_mapped1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_format1", &Tests::test_format1));
 
     s->addTest(new CppUnit::TestCaller<Tests>("test_iter1", &Tests::test_iter1));
 
@@ -0,0 +1,188 @@
+#include <cppunit/TestCase.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/ui/text/TextTestRunner.h>
+
+#include <iostream>
+#include <sstream>
+// the statistics are counted in this program only, see shared_ptr_vector_stats.h
+#define SHARED_PTR_VECTOR_STATS
+#include <shared_ptr_vector.h>
+using namespace std;
+
+class Tests : public CppUnit::TestFixture
+{
+public:
+  void setUp()
+  {
+    //cout << "Tests::setUp called" << endl;
+  }
+  void tearDown()
+  {
+    //cout << "Tests::tearDown called" << endl;
+  }
+
+  void title(const char* h)
+  {
+    cout << "-------------------\n"
+         << h << "\n"
+         << "--------------------\n";
+  }
+
+public:
+  void test_stats1()
+  {
+    title("test_stats1() called");
+
+    const size_t slot = sizeof(shared_ptr<int>);
+    shared_ptr_vector_stats g0 = shared_ptr_vector_stats::global();
+    {
+      shared_ptr_vector<int> v1;
+      v1.reserve(4);
+      v1.push_back(1);
+      v1.emplace_back(2);
+      v1.push_back(new int(3));
+      shared_ptr_vector_stats s1 = v1.stats();
+      CPPUNIT_ASSERT(2 == s1.element_allocations);
+      CPPUNIT_ASSERT(1 == s1.control_block_allocations);
+      CPPUNIT_ASSERT(1 == s1.spine_reallocations);
+      CPPUNIT_ASSERT(4 * slot == s1.bytes_reserved);
+      CPPUNIT_ASSERT(3 * slot == s1.bytes_used);
+
+      shared_ptr_vector<int> v2(v1);
+      CPPUNIT_ASSERT(3 == v2.stats().refcount_increments);
+      v2.push_back(nullptr);
+      v2.erase(v2.begin(), v2.end());
+      CPPUNIT_ASSERT(3 == v2.stats().refcount_decrements);
+      v2.reset_stats();
+      CPPUNIT_ASSERT(0 == v2.stats().refcount_increments);
+
+      shared_ptr_vector_stats g1 = shared_ptr_vector_stats::global();
+      CPPUNIT_ASSERT(g1.element_allocations - g0.element_allocations == 2);
+      CPPUNIT_ASSERT(g1.refcount_increments - g0.refcount_increments == 3);
+      CPPUNIT_ASSERT(g1.bytes_used - g0.bytes_used == 3 * slot);
+
+      // a parallel sort merges into a new spine
+      shared_ptr_vector<int> v3;
+      for (int i = 0; i < 100; ++i)
+        v3.emplace_back(100 - i);
+      v3.reset_stats();
+      v3.sort(shared_ptr_vector_parallel(4, 10));
+      CPPUNIT_ASSERT(1 == v3.stats().spine_reallocations);
+      CPPUNIT_ASSERT("[ 1 2 3" == to_string(v3).substr(0, 7));
+    }
+    shared_ptr_vector_stats g2 = shared_ptr_vector_stats::global();
+    CPPUNIT_ASSERT(g2.bytes_used == g0.bytes_used);
+    CPPUNIT_ASSERT(g2.bytes_reserved == g0.bytes_reserved);
+    CPPUNIT_ASSERT(g2.refcount_decrements - g0.refcount_decrements == 106);
+    shared_ptr_vector_stats::reset_global();
+    CPPUNIT_ASSERT(0 == shared_ptr_vector_stats::global().element_allocations);
+    CPPUNIT_ASSERT(g2.bytes_used == shared_ptr_vector_stats::global().bytes_used);
+  }
+
+  // a std::allocator which is not one, so that the spine is a std::vector
+  template<typename _Tp>
+  struct OtherAlloc : std::allocator<_Tp>
+  {
+    template<typename _Up> struct rebind { typedef OtherAlloc<_Up> other; };
+    OtherAlloc() { }
+    template<typename _Up> OtherAlloc(const OtherAlloc<_Up>&) { }
+  };
+
+  void test_stats2()
+  {
+    title("test_stats2() called");
+
+    // the references made by the containers (elements, control blocks and
+    // increments) are all released by them (decrements)
+    shared_ptr_vector_stats g0 = shared_ptr_vector_stats::global();
+    shared_ptr_reclaimer r;
+    {
+      shared_ptr_vector<int> v1(3, new int(7));
+      v1.resize(5, new int(8));
+      v1.insert(v1.begin() + 1, 2, new int(9));
+      v1.at(0, new int(1));
+      v1.push_back(2);
+      v1.emplace_back(3);
+      v1.insert(v1.begin(), { new int(4), nullptr });
+      v1.sort(shared_ptr_vector_parallel(4, 2));
+      v1.sort_by_key([](int x) { return -x; });
+
+      shared_ptr_vector<int> v2(v1);
+      v2 = v1;
+      v2.erase(v2.begin());
+      v2.erase(v2.begin(), v2.begin() + 2);
+      v2.pop_back();
+      std::vector<shared_ptr<int> > w = v1.release();
+      v2.insert(v2.end(), w.begin(), w.end());
+      v1.adopt(std::move(w));
+      v2.resize(3);
+
+      std::ostringstream os;
+      v1.serialize(os);
+      std::istringstream is(os.str());
+      shared_ptr_vector<int> v3;
+      v3.deserialize(is);
+      CPPUNIT_ASSERT(to_string(v1) == to_string(v3));
+
+      shared_ptr_vector<int> v4 = v3.extract(v3.begin(), v3.begin() + 2);
+      v4.splice(v4.end(), v3);
+      v4.shrink_to_fit();
+      v4.enable_recycling(4);
+      v4.pop_back();
+      v4.clear();
+      v4.emplace_back(5);
+      v4.enable_recycling(0);
+
+      v3 = v1;
+      v3.set_reclaimer(&r);
+      v3.erase(v3.begin());
+      v3.pop_back();
+      v3.clear();
+      v3.push_back(6);
+
+      shared_ptr_vector<int> v5(std::move(v2));
+      v5 = std::move(v1);
+      v1.assign(2, new int(6));
+      v1.adopt(v5.release());
+
+      typedef shared_ptr_vector<int, OtherAlloc<shared_ptr<int> > > other_vector;
+      other_vector v6(2, new int(1));
+      v6.push_back(2);
+      other_vector v7(v6, OtherAlloc<shared_ptr<int> >());
+      v7.adopt(v6.release());
+      v7.insert(v7.begin(), 3, new int(3));
+      v7.erase(v7.begin() + 1, v7.end() - 1);
+      other_vector v8(std::move(v7), OtherAlloc<shared_ptr<int> >());
+      v8.sort(shared_ptr_vector_parallel(2, 1));
+    }
+    r.reclaim();
+    shared_ptr_vector_stats g1 = shared_ptr_vector_stats::global();
+    CPPUNIT_ASSERT(g1.element_allocations - g0.element_allocations
+                   + g1.control_block_allocations - g0.control_block_allocations
+                   + g1.refcount_increments - g0.refcount_increments
+                   == g1.refcount_decrements - g0.refcount_decrements);
+    CPPUNIT_ASSERT(g1.bytes_used == g0.bytes_used);
+    CPPUNIT_ASSERT(g1.bytes_reserved == g0.bytes_reserved);
+  }
+
+public:
+  static CppUnit::Test* suite()
+  {
+    CppUnit::TestSuite* s = new CppUnit::TestSuite(" Test Test ");
+
+    s->addTest(new CppUnit::TestCaller<Tests>("test_stats1", &Tests::test_stats1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_stats2", &Tests::test_stats2));
+
+    return s;
+  }
+};
+
+int
+main()//int argc, char* argv[])
+{
+  CppUnit::TextTestRunner r;
+  r.addTest(Tests::suite());
+  r.run();
+  return 0;
+}
@@ -0,0 +1,168 @@
+#include <cppunit/TestCase.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/ui/text/TextTestRunner.h>
+
+#include <iostream>
+#include <thread>
+#include <vector>
+// the operations are traced in this program only
+#define SHARED_PTR_VECTOR_TRACE
+#include <shared_ptr_vector.h>
+using namespace std;
+
+class Tests : public CppUnit::TestFixture
+{
+public:
+  void setUp()
+  {
+    //cout << "Tests::setUp called" << endl;
+  }
+  void tearDown()
+  {
+    //cout << "Tests::tearDown called" << endl;
+  }
+
+  void title(const char* h)
+  {
+    cout << "-------------------\n"
+         << h << "\n"
+         << "--------------------\n";
+  }
+
+  // the events of container __c, in order
+  static vector<shared_ptr_vector_event>
+  events_of(const void* __c)
+  {
+    vector<shared_ptr_vector_event> v;
+    vector<shared_ptr_vector_event> all = shared_ptr_vector_trace::events();
+    for (auto i = all.begin(); i != all.end(); ++i)
+      if (i->container == __c)
+        v.push_back(*i);
+    return v;
+  }
+
+public:
+  void test_trace1()
+  {
+    title("test_trace1() called");
+
+    shared_ptr_vector_trace::clear();
+    shared_ptr_vector<int>* v1 = new shared_ptr_vector<int>{new int(3), new int(1), new int(2)};
+    v1->sort();
+    v1->resize(5);
+    shared_ptr_vector<int>* v2 = new shared_ptr_vector<int>(*v1);
+    v1->clear();
+    delete v1;
+    delete v2;
+
+    vector<shared_ptr_vector_event> e = events_of(v1);
+    CPPUNIT_ASSERT(5 == e.size());
+    CPPUNIT_ASSERT(shared_ptr_vector_op::ctor == e[0].op);
+    CPPUNIT_ASSERT(3 == e[0].size);
+    CPPUNIT_ASSERT(shared_ptr_vector_op::sort == e[1].op);
+    CPPUNIT_ASSERT(3 == e[1].size);
+    CPPUNIT_ASSERT(shared_ptr_vector_op::resize == e[2].op);
+    CPPUNIT_ASSERT(5 == e[2].size);
+    CPPUNIT_ASSERT(shared_ptr_vector_op::clear == e[3].op);
+    CPPUNIT_ASSERT(0 == e[3].size);
+    CPPUNIT_ASSERT(shared_ptr_vector_op::dtor == e[4].op);
+    CPPUNIT_ASSERT(0 == e[4].size);
+    for (size_t i = 1; i < e.size(); ++i)
+      CPPUNIT_ASSERT(e[i - 1].start_ns <= e[i].start_ns);
+
+    // the dtor releases the slots within its event, which ends empty
+    e = events_of(v2);
+    CPPUNIT_ASSERT(2 == e.size());
+    CPPUNIT_ASSERT(shared_ptr_vector_op::copy_ctor == e[0].op);
+    CPPUNIT_ASSERT(5 == e[0].size);
+    CPPUNIT_ASSERT(shared_ptr_vector_op::dtor == e[1].op);
+    CPPUNIT_ASSERT(0 == e[1].size);
+  }
+
+  void test_trace2()
+  {
+    title("test_trace2() called");
+
+    shared_ptr_vector_trace::clear();
+    shared_ptr_vector<int>* v1 = nullptr;
+    std::thread t([&v1]
+                  {
+                    v1 = new shared_ptr_vector<int>{new int(1), new int(2)};
+                    v1->sort();
+                  });
+    t.join();
+    v1->clear();
+    delete v1;
+
+    // each thread records into its own buffer
+    vector<shared_ptr_vector_event> e = events_of(v1);
+    CPPUNIT_ASSERT(4 == e.size());
+    CPPUNIT_ASSERT(shared_ptr_vector_op::ctor == e[0].op);
+    CPPUNIT_ASSERT(shared_ptr_vector_op::sort == e[1].op);
+    CPPUNIT_ASSERT(shared_ptr_vector_op::clear == e[2].op);
+    CPPUNIT_ASSERT(shared_ptr_vector_op::dtor == e[3].op);
+    CPPUNIT_ASSERT(e[0].thread == e[1].thread);
+    CPPUNIT_ASSERT(e[1].thread != e[2].thread);
+    CPPUNIT_ASSERT(e[2].thread == e[3].thread);
+
+    shared_ptr_vector_trace::clear();
+    CPPUNIT_ASSERT(shared_ptr_vector_trace::events().empty());
+  }
+
+  void test_trace3()
+  {
+    title("test_trace3() called");
+
+    shared_ptr_vector_trace::clear();
+    shared_ptr_vector<int> v1;
+    shared_ptr_vector<int> v2;
+    for (int i = 0; i < 2; ++i)
+    {
+      std::thread t([&v1] { v1.resize(1); });
+      t.join();
+    }
+    const size_t n = shared_ptr_vector_trace::buffers();
+
+    // an exited thread gives its buffer back to the next one
+    for (int i = 0; i < 50; ++i)
+    {
+      std::thread t([&v2] { v2.resize(v2.size() + 1); });
+      t.join();
+    }
+    CPPUNIT_ASSERT(n == shared_ptr_vector_trace::buffers());
+
+    // and its events can still be read, under its own thread index
+    vector<shared_ptr_vector_event> e = events_of(&v2);
+    CPPUNIT_ASSERT(51 == e.size());
+    CPPUNIT_ASSERT(shared_ptr_vector_op::ctor == e[0].op);
+    for (size_t i = 1; i < e.size(); ++i)
+    {
+      CPPUNIT_ASSERT(shared_ptr_vector_op::resize == e[i].op);
+      CPPUNIT_ASSERT(i == e[i].size);
+      CPPUNIT_ASSERT(e[i - 1].thread != e[i].thread);
+    }
+    CPPUNIT_ASSERT(3 == events_of(&v1).size());
+  }
+
+public:
+  static CppUnit::Test* suite()
+  {
+    CppUnit::TestSuite* s = new CppUnit::TestSuite(" Test Test ");
+
+    s->addTest(new CppUnit::TestCaller<Tests>("test_trace1", &Tests::test_trace1));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_trace2", &Tests::test_trace2));
+    s->addTest(new CppUnit::TestCaller<Tests>("test_trace3", &Tests::test_trace3));
+
+    return s;
+  }
+};
+
+int
+main()//int argc, char* argv[])
+{
+  CppUnit::TextTestRunner r;
+  r.addTest(Tests::suite());
+  r.run();
+  return 0;
+}